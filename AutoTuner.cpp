@@ -0,0 +1,214 @@
+#include "AutoTuner.h"
+#include "Benchmark.h"
+#include "ClProfiling.h"
+
+// STD
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <stdio.h>
+
+#ifdef _WIN32
+  #include <process.h>
+#else
+  #include <unistd.h>
+#endif
+
+static const char* tuning_magic = "CLTUNING 1";
+
+// search space besides the local sizes, which are powers of two up to CL_KERNEL_WORK_GROUP_SIZE.
+static const int tune_vector_widths[] = { 1, 2, 4, 8, 16 };
+static const int tune_elements_per_item[] = { 1, 2, 4, 8 };
+
+TunedConfig::TunedConfig() : local_ws(0), trial_ms(0.0), stored(false) {}
+
+AutoTuner::AutoTuner(const std::string& file_name) : m_file_name(file_name) {
+  load();
+}
+
+std::string AutoTuner::key(const ClDevice& device, const BenchOptions& options, const std::string& mode, size_t mem_size) const {
+  std::ostringstream ss;
+  ss << device.features.profileKey() << "|" << options.kernel_file << "|" << options.tune_family << "|" << mode << "|" << mem_size;
+  if (options.tune_family == "compute")
+    ss << "|" << options.compute_iterations;
+  return ss.str();
+}
+
+bool AutoTuner::lookup(const std::string& key, const BenchOptions& options, TunedConfig& config) const {
+  std::map<std::string, std::string>::const_iterator it = m_entries.find(key);
+  if (it == m_entries.end())
+    return false;
+
+  std::istringstream ss(it->second);
+  std::string variant_name;
+  size_t local_ws = 0;
+  double trial_ms = 0.0;
+  ClKernelVariant variant;
+  if (!(ss >> variant_name >> local_ws >> trial_ms) || local_ws == 0 || !ClKernelVariant::parse(variant_name, variant))
+    return false;
+
+  config.variant = variant;
+  config.variant.setComputeIterations(options.compute_iterations);
+  config.local_ws = local_ws;
+  config.trial_ms = trial_ms;
+  config.stored = true;
+  return true;
+}
+
+bool AutoTuner::measure(ClContext* cl, const ClDevice& device, const BenchOptions& options, TransferStrategy& strategy,
+                        size_t mem_size, TunedConfig& config, BenchReport* trials) {
+  cl_int error;
+
+  std::vector<ClKernelVariant> variants;
+  for (size_t w = 0; w < sizeof(tune_vector_widths) / sizeof(tune_vector_widths[0]); w++){
+    for (size_t e = 0; e < sizeof(tune_elements_per_item) / sizeof(tune_elements_per_item[0]); e++){
+      ClKernelVariant variant;
+      ClKernelVariant::parse(options.tune_family + ":float", variant);
+      variant.setElementType("float", tune_vector_widths[w]);
+      variant.setElementsPerItem(tune_elements_per_item[e]);
+      variant.setComputeIterations(options.compute_iterations);
+      variants.push_back(variant);
+    }
+  }
+
+  // all candidates compile at the same time.
+  std::vector< boost::shared_future<const ClProgramEntry*> > builds;
+  for (size_t v = 0; v < variants.size(); v++)
+    builds.push_back(cl->getProgramAsync(options.kernel_file, variants[v].buildOptions(), device));
+  for (size_t v = 0; v < builds.size(); v++)
+    builds[v].wait();
+
+  bool profile = (device.queue_properties & CL_QUEUE_PROFILING_ENABLE) != 0;
+  HostClock::time_point beg_time = HostClock::now();
+  int n_trials = 0;
+  config.local_ws = 0;
+
+  for (size_t v = 0; v < variants.size(); v++){
+    cl_kernel kernel = cl->createKernel(options.kernel_file, variants[v], variants[v].kernelName(), device);
+    if (!kernel)
+      continue;
+
+    size_t max_local_ws = 0;
+    error = clGetKernelWorkGroupInfo(kernel, device.id, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &max_local_ws, nullptr); cl->checkError(error);
+    size_t work_items = variants[v].workItems(mem_size * sizeof(cl_float4));
+
+    for (size_t local_ws = options.sweep_local_min; local_ws <= max_local_ws; local_ws *= 2){
+      // larger work-groups only add idle work-items or do not fit the local memory.
+      if (local_ws > options.sweep_local_min && local_ws / 2 >= work_items)
+        break;
+      if (variants[v].localMemBytes(local_ws) > device.features.local_mem_size)
+        break;
+
+      setTransferKernelArgs(kernel, strategy, mem_size, local_ws, variants[v]);
+      std::vector<double> samples;
+      bool launched = true;
+      for (int i = 0; i <= options.tune_trials && launched; i++){
+        IterationTiming timing;
+        launched = runTransferIteration(cl, device, kernel, strategy, mem_size, local_ws, timing, variants[v]);
+        // the first launch is a warmup
+        if (i > 0)
+          samples.push_back(profile ? timing.kernel.durationMs() : timing.wall_ms);
+      }
+      // a candidate that does not launch (e.g. CL_OUT_OF_RESOURCES) would win with a near zero time.
+      if (!launched){
+        std::cout << "Tuning: dropping " << variants[v].name() << " with local ws " << local_ws << ", the launch failed" << std::endl;
+        continue;
+      }
+      double median = computeStats(samples).median;
+      n_trials++;
+
+      if (trials){
+        BenchRecord record;
+        record.set("tuning_trial", true);
+        record.set("device", device.features.device_name);
+        record.set("mode", strategy.name());
+        record.set("elements", mem_size);
+        record.set("variant", variants[v].name());
+        record.set("local_ws", local_ws);
+        record.set(profile ? "kernel_median_ms" : "median_ms", median);
+        trials->add(record);
+      }
+
+      if (config.local_ws == 0 || median < config.trial_ms){
+        config.variant = variants[v];
+        config.local_ws = local_ws;
+        config.trial_ms = median;
+      }
+    }
+    clReleaseKernel(kernel);
+  }
+
+  std::cout << "Tuning: " << n_trials << " trials in " << elapsedMs(beg_time, HostClock::now()) << " ms" << std::endl;
+  config.stored = false;
+  return config.local_ws != 0;
+}
+
+bool AutoTuner::tune(ClContext* cl, const ClDevice& device, const BenchOptions& options, TransferStrategy& strategy,
+                     size_t mem_size, TunedConfig& config, BenchReport* trials) {
+  std::string entry_key = key(device, options, strategy.name(), mem_size);
+  if (options.retune || !lookup(entry_key, options, config)){
+    if (!measure(cl, device, options, strategy, mem_size, config, trials))
+      return false;
+
+    std::ostringstream value;
+    value << config.variant.name() << " " << config.local_ws << " " << config.trial_ms;
+    m_entries[entry_key] = value.str();
+    if (!save())
+      std::cerr << "Cannot write the tuning file " << m_file_name << std::endl;
+  }
+
+  std::cout << "Tuned " << strategy.name() << ", " << mem_size << " elements: variant " << config.variant.name()
+            << ", local ws " << config.local_ws << (config.stored ? " (stored)" : "") << std::endl;
+  return true;
+}
+
+void AutoTuner::load() {
+  if (m_file_name.empty())
+    return;
+  std::ifstream file(m_file_name.c_str());
+  std::string line;
+  if (!file || !std::getline(file, line) || line != tuning_magic)
+    return;
+
+  while (std::getline(file, line)){
+    size_t tab = line.rfind('\t');
+    if (tab != std::string::npos)
+      m_entries[line.substr(0, tab)] = line.substr(tab + 1);
+  }
+}
+
+bool AutoTuner::save() const {
+  if (m_file_name.empty())
+    return true;
+
+  // written to a temporary name and renamed, like the program cache.
+  std::ostringstream tmp_path_ss;
+#ifdef _WIN32
+  tmp_path_ss << m_file_name << ".tmp" << _getpid();
+#else
+  tmp_path_ss << m_file_name << ".tmp" << getpid();
+#endif
+  std::string tmp_path = tmp_path_ss.str();
+
+  std::ofstream file(tmp_path.c_str());
+  if (!file)
+    return false;
+  file << tuning_magic << "\n";
+  for (std::map<std::string, std::string>::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+    file << it->first << "\t" << it->second << "\n";
+  file.close();
+  if (!file){
+    remove(tmp_path.c_str());
+    return false;
+  }
+
+#ifdef _WIN32
+  remove(m_file_name.c_str());
+#endif
+  if (rename(tmp_path.c_str(), m_file_name.c_str()) != 0){
+    remove(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,49 @@
+#ifndef __AUTO_TUNER_H__
+#define __AUTO_TUNER_H__
+
+// STD
+#include <map>
+#include <string>
+
+#include "ClContext.h"
+#include "BenchOptions.h"
+#include "BenchReport.h"
+#include "ClKernelVariant.h"
+#include "TransferStrategy.h"
+
+// Launch configuration of a kernel family picked by the tuner.
+struct TunedConfig {
+  ClKernelVariant variant;    // vector width and elements per work-item
+  size_t          local_ws;
+  double          trial_ms;   // median of the winning trial
+  bool            stored;     // read from the tuning file, not measured in this run
+
+  TunedConfig();
+};
+
+// Searches the local size, the elements per work-item and the vector width of one kernel family
+// with short timed trials (kernel time with --profile, wall time otherwise).
+// The winner is remembered per device profile (ClDeviceFeatures::profileKey), kernel file, family,
+// transfer mode and size in a text file, later runs reuse it without measuring.
+class AutoTuner {
+public:
+  AutoTuner(const std::string& file_name);
+
+  // Fills config from the tuning file or, if there is no entry or options.retune is set, by measuring
+  // with strategy, which has to hold at least mem_size elements. Every trial is added to trials, if given.
+  bool tune(ClContext* cl, const ClDevice& device, const BenchOptions& options, TransferStrategy& strategy,
+            size_t mem_size, TunedConfig& config, BenchReport* trials = nullptr);
+
+private:
+  std::string key(const ClDevice& device, const BenchOptions& options, const std::string& mode, size_t mem_size) const;
+  bool lookup(const std::string& key, const BenchOptions& options, TunedConfig& config) const;
+  bool measure(ClContext* cl, const ClDevice& device, const BenchOptions& options, TransferStrategy& strategy,
+               size_t mem_size, TunedConfig& config, BenchReport* trials);
+  void load();
+  bool save() const;
+
+  std::string                         m_file_name;
+  std::map<std::string, std::string>  m_entries;    // key -> "variant local_ws trial_ms"
+};
+
+#endif
@@ -0,0 +1,196 @@
+#include "BatchedBenchmark.h"
+#include "ClCommandGraph.h"
+#include "ClProfiling.h"
+#include "BenchStats.h"
+#include "HostBufferPool.h"
+#include "InputGenerator.h"
+
+// STD
+#include <iostream>
+#include <vector>
+
+// Buffers and chunking of one size.
+struct BatchedWorkload {
+  cl_mem      device_a;
+  cl_mem      device_c;
+  cl_float4*  host_a;
+  cl_float4*  host_c;
+  size_t      chunk;      // elements per launch, a multiple of the local size
+  size_t      launches;
+  cl_int      count;
+};
+
+// The write, kernel and read of every chunk, chunk i on queue i % queues (-1: round robin).
+static void buildGraph(ClCommandGraph& graph, const BatchedWorkload& work, cl_kernel kernel, size_t local_ws, int queues) {
+  size_t bytes = work.chunk * sizeof(cl_float4);
+  for (size_t i = 0; i < work.launches; i++){
+    int queue = queues > 0 ? static_cast<int>(i % queues) : -1;
+    size_t offset = i * work.chunk;
+    std::vector<int> deps(1);
+    deps[0] = graph.addWrite(work.device_a, offset * sizeof(cl_float4), bytes, work.host_a + offset, std::vector<int>(), queue);
+    int node = graph.addKernel(kernel, offset, work.chunk, local_ws, deps, queue);
+    graph.setArg(node, 0, work.device_a);
+    graph.setArg(node, 1, work.device_c);
+    graph.setArg(node, 2, work.count);
+    deps[0] = node;
+    graph.addRead(work.device_c, offset * sizeof(cl_float4), bytes, work.host_c + offset, deps, queue);
+  }
+}
+
+// one graph of the blocking scheme: every command waits for the previous one on the host.
+static bool runBlocking(ClContext* cl, const ClDevice& device, const BatchedWorkload& work, cl_kernel kernel, size_t local_ws) {
+  cl_int error;
+  size_t bytes = work.chunk * sizeof(cl_float4);
+  clSetKernelArg(kernel, 0, sizeof(cl_mem), &work.device_a);
+  clSetKernelArg(kernel, 1, sizeof(cl_mem), &work.device_c);
+  clSetKernelArg(kernel, 2, sizeof(cl_int), &work.count);
+  for (size_t i = 0; i < work.launches; i++){
+    size_t offset = i * work.chunk;
+    size_t global_ws = work.chunk;
+    error = clEnqueueWriteBuffer(device.cmd_queue, work.device_a, CL_FALSE, offset * sizeof(cl_float4), bytes, work.host_a + offset, 0, nullptr, nullptr); cl->checkError(error);
+    clFinish(device.cmd_queue);
+    error = clEnqueueNDRangeKernel(device.cmd_queue, kernel, 1, &offset, &global_ws, &local_ws, 0, nullptr, nullptr); cl->checkError(error);
+    clFinish(device.cmd_queue);
+    error = clEnqueueReadBuffer(device.cmd_queue, work.device_c, CL_FALSE, offset * sizeof(cl_float4), bytes, work.host_c + offset, 0, nullptr, nullptr); cl->checkError(error);
+    clFinish(device.cmd_queue);
+    if (error != CL_SUCCESS)
+      return false;
+  }
+  return true;
+}
+
+void runBatchedComparison(ClContext* cl, const ClDevice& device, cl_kernel kernel, const BenchOptions& options, BenchReport& report) {
+  static const char* const schemes[] = { "blocking", "in_order", "out_of_order", "multi_queue" };
+  size_t n_schemes = sizeof(schemes) / sizeof(schemes[0]);
+  size_t local_ws = options.local_ws;
+  HostBufferPool* pool = HostBufferPool::getSingletonPtr();
+
+  for (size_t s = 0; s < options.sizes.size(); s++){
+    size_t mem_size = options.sizes[s];
+    size_t bytes = mem_size * sizeof(cl_float4);
+
+    BatchedWorkload work;
+    work.chunk = mem_size / options.batch_launches / local_ws * local_ws;
+    if (work.chunk < local_ws)
+      work.chunk = local_ws;
+    work.launches = mem_size / work.chunk;
+    work.count = static_cast<cl_int>(mem_size);
+    if (work.launches == 0){
+      std::cout << "Skipping " << mem_size << " elements: smaller than one local size\n";
+      continue;
+    }
+
+    cl_int error;
+    work.device_a = clCreateBuffer(device.ctx, CL_MEM_READ_ONLY, bytes, nullptr, &error); cl->checkError(error);
+    work.device_c = clCreateBuffer(device.ctx, CL_MEM_WRITE_ONLY, bytes, nullptr, &error); cl->checkError(error);
+    work.host_a = static_cast<cl_float4*>(pool->acquire(bytes));
+    work.host_c = static_cast<cl_float4*>(pool->acquire(bytes));
+    if (!work.device_a || !work.device_c || !work.host_a || !work.host_c){
+      std::cerr << "Cannot allocate the batched workload of " << mem_size << " elements\n";
+      if (work.device_a) clReleaseMemObject(work.device_a);
+      if (work.device_c) clReleaseMemObject(work.device_c);
+      pool->release(work.host_a);
+      pool->release(work.host_c);
+      continue;
+    }
+    generateInputParallel(work.host_a, mem_size, options.seed);
+
+    double blocking_median = 0.0;
+    for (size_t m = 0; m < n_schemes; m++){
+      std::string scheme = schemes[m];
+
+      // the graph schemes get queues of their own, the blocking one uses the device queue.
+      std::vector<cl_command_queue> queues;
+      if (scheme == "in_order")
+        queues.push_back(cl->createCommandQueue(device, 0));
+      else if (scheme == "out_of_order")
+        queues.push_back(cl->createCommandQueue(device, CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE));
+      else if (scheme == "multi_queue"){
+        for (int q = 0; q < options.batch_queues; q++)
+          queues.push_back(cl->createCommandQueue(device, 0));
+      }
+      bool created = true;
+      for (size_t q = 0; q < queues.size(); q++)
+        created = queues[q] != 0 && created;
+      if (!created){
+        std::cout << "Skipping " << scheme << ": the device cannot create the queues\n";
+        for (size_t q = 0; q < queues.size(); q++){
+          if (queues[q])
+            clReleaseCommandQueue(queues[q]);
+        }
+        continue;
+      }
+
+      std::cout << "Device: " << device.features.device_name << ", submission: " << scheme << ", launches: " << work.launches
+                << ", elements per launch: " << work.chunk << std::endl;
+
+      std::vector<double> samples;
+      ClCommandGraphStats graph_stats;
+      bool ok = true;
+      if (queues.empty()){
+        for (int i = 0; i < options.warmup + options.iterations && ok; i++){
+          HostClock::time_point beg = HostClock::now();
+          ok = runBlocking(cl, device, work, kernel, local_ws);
+          if (i >= options.warmup)
+            samples.push_back(elapsedMs(beg, HostClock::now()));
+        }
+      }
+      else {
+        ClCommandGraph graph(cl, queues);
+        buildGraph(graph, work, kernel, local_ws, scheme == "multi_queue" ? options.batch_queues : 0);
+        for (int i = 0; i < options.warmup + options.iterations && ok; i++){
+          HostClock::time_point beg = HostClock::now();
+          ok = graph.submit();
+          graph.finish();
+          if (i >= options.warmup)
+            samples.push_back(elapsedMs(beg, HostClock::now()));
+        }
+        graph_stats = graph.stats();
+      }
+
+      for (size_t q = 0; q < queues.size(); q++)
+        clReleaseCommandQueue(queues[q]);
+      if (!ok){
+        std::cout << "Skipping " << scheme << ": a command failed\n";
+        continue;
+      }
+
+      SampleStats stats = computeStats(samples);
+      size_t commands = 3 * work.launches;
+      if (m == 0)
+        blocking_median = stats.median;
+
+      BenchRecord record;
+      record.set("device", device.features.device_name);
+      record.set("platform", device.features.platform_name);
+      record.set("mode", "batched");
+      record.set("submission", scheme);
+      record.set("elements", mem_size);
+      record.set("launches", work.launches);
+      record.set("elements_per_launch", work.chunk);
+      record.set("commands", commands);
+      record.set("queues", queues.empty() ? static_cast<size_t>(1) : queues.size());
+      record.set("local_ws", local_ws);
+      record.set("warmup", options.warmup);
+      record.set("iterations", samples.size());
+      setStats(record, "", "_ms", stats);
+      record.set("us_per_command", commands > 0 ? stats.median * 1000.0 / commands : 0.0);
+      record.set("commands_per_sec", stats.median > 0.0 ? commands * 1000.0 / stats.median : 0.0);
+      record.set("bandwidth_gbs", bandwidthGBs(2.0 * work.launches * work.chunk * sizeof(cl_float4), stats.median));
+      record.set("speedup_vs_blocking", stats.median > 0.0 ? blocking_median / stats.median : 0.0);
+      if (!queues.empty()){
+        // per submit, the stats add up over warmup and timed submits.
+        size_t submits = static_cast<size_t>(options.warmup + options.iterations);
+        record.set("events_per_graph", graph_stats.events / submits);
+        record.set("waits_per_graph", graph_stats.waits / submits);
+      }
+      report.add(record);
+      std::cout << "Median = " << stats.median << " ms, " << (commands > 0 ? stats.median * 1000.0 / commands : 0.0) << " us per command\n";
+    }
+
+    clReleaseMemObject(work.device_a);
+    clReleaseMemObject(work.device_c);
+    pool->release(work.host_a);
+    pool->release(work.host_c);
+  }
+}
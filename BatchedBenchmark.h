@@ -0,0 +1,17 @@
+#ifndef __BATCHED_BENCHMARK_H__
+#define __BATCHED_BENCHMARK_H__
+
+#include "ClContext.h"
+#include "BenchOptions.h"
+#include "BenchReport.h"
+
+// Workload of many small dispatches: every size is cut into options.batch_launches chunks, each one
+// written, copied by the kernel and read back (three commands). Compares the submission schemes:
+//   blocking      one in-order queue, clFinish after every command
+//   in_order      ClCommandGraph on one in-order queue, one flush and finish per graph
+//   out_of_order  ClCommandGraph on one out-of-order queue, the chains are ordered by events
+//   multi_queue   ClCommandGraph on options.batch_queues in-order queues, one chain per queue
+// and reports the time per graph and per command. Schemes the device cannot run are skipped.
+void runBatchedComparison(ClContext* cl, const ClDevice& device, cl_kernel kernel, const BenchOptions& options, BenchReport& report);
+
+#endif
@@ -0,0 +1,530 @@
+#include "BenchOptions.h"
+#include "ClContext.h"
+#include "TransferStrategy.h"
+#include "ClKernelVariant.h"
+#include "InputGenerator.h"
+
+// STD
+#include <iostream>
+#include <sstream>
+#include <stdlib.h>
+
+BenchOptions::BenchOptions() :
+  device("0"),
+  device_types("all"),
+  iterations(100),
+  max_iterations(1000),
+  confidence(0.0),
+  warmup(5),
+  local_ws(32),
+  kernel_file("testKernel.cl"),
+  program_cache("cl_cache"),
+  fail_fast(false),
+  output("bench_results.json"),
+  sweep(false),
+  sweep_min(256),
+  sweep_max(0),
+  sweep_step(2.0),
+  sweep_local_min(16),
+  compute_iterations(64),
+  tune(false),
+  tune_family("copy"),
+  tuning_file("cl_tuning.txt"),
+  retune(false),
+  tune_trials(5),
+  pipeline_depth(0),
+  gl_sync(false),
+  batch_launches(0),
+  batch_queues(2),
+  overhead_samples(0),
+  split(false),
+  sub_devices(0),
+  seed(default_input_seed),
+  fill_mapped(true),
+  mem_pool_arena(0),
+  huge_pages(false),
+  lock_memory(false),
+  gl_backend("auto"),
+  profile(false),
+  list_devices(false),
+  help(false) {
+  modes.push_back("copy");
+  sizes.push_back(16 * 1024 * 1024);
+}
+
+bool parseSize(const std::string& str, size_t& size) {
+  if (str.empty())
+    return false;
+
+  char* end = 0;
+  unsigned long long value = strtoull(str.c_str(), &end, 10);
+  if (end == str.c_str())
+    return false;
+
+  std::string suffix(end);
+  if (suffix == "")                         size = static_cast<size_t>(value);
+  else if (suffix == "K" || suffix == "k")  size = static_cast<size_t>(value << 10);
+  else if (suffix == "M" || suffix == "m")  size = static_cast<size_t>(value << 20);
+  else if (suffix == "G" || suffix == "g")  size = static_cast<size_t>(value << 30);
+  else
+    return false;
+
+  return size > 0;
+}
+
+bool modesNeedGl(const std::vector<std::string>& modes) {
+  for (size_t i = 0; i < modes.size(); i++) {
+    if (transferStrategyNeedsGl(modes[i]))
+      return true;
+  }
+  return false;
+}
+
+std::vector<std::string> runModeOptions(const BenchOptions& options) {
+  std::vector<std::string> run_modes;
+  if (options.gl_sync)              run_modes.push_back("--gl-sync");
+  if (options.batch_launches > 0)   run_modes.push_back("--batch");
+  if (options.overhead_samples > 0) run_modes.push_back("--overhead");
+  if (options.pipeline_depth > 0)   run_modes.push_back("--pipeline");
+  if (options.sweep)                run_modes.push_back("--sweep");
+  if (options.tune)                 run_modes.push_back("--tune");
+  if (!options.variants.empty())    run_modes.push_back("--variants");
+  return run_modes;
+}
+
+bool optionsNeedGl(const BenchOptions& options) {
+  if (options.gl_sync)
+    return true;
+  if (options.batch_launches > 0)
+    return false;
+  // only for the acquire/release test, see OverheadBenchmark
+  if (options.overhead_samples > 0)
+    return options.gl_backend != "none";
+  return modesNeedGl(options.modes);
+}
+
+static std::vector<std::string> splitList(const std::string& str) {
+  std::vector<std::string> items;
+  std::stringstream ss(str);
+  std::string item;
+  while (std::getline(ss, item, ','))
+    items.push_back(item);
+  return items;
+}
+
+static bool parseSizeList(const std::string& str, std::vector<size_t>& sizes) {
+  std::vector<std::string> items = splitList(str);
+  sizes.clear();
+  for (size_t i = 0; i < items.size(); i++) {
+    size_t size = 0;
+    if (!parseSize(items[i], size))
+      return false;
+    sizes.push_back(size);
+  }
+  return !sizes.empty();
+}
+
+static bool parseInt(const std::string& str, int& value) {
+  char* end = 0;
+  long v = strtol(str.c_str(), &end, 10);
+  if (str.empty() || *end != '\0' || v < 0)
+    return false;
+  value = static_cast<int>(v);
+  return true;
+}
+
+static bool parseDouble(const std::string& str, double& value) {
+  char* end = 0;
+  double v = strtod(str.c_str(), &end);
+  if (str.empty() || *end != '\0' || v < 0.0)
+    return false;
+  value = v;
+  return true;
+}
+
+bool parseBenchOptions(int argc, char** argv, BenchOptions& options, std::string& error) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    std::string value;
+    bool has_value = false;
+
+    // accept both "--name=value" and "--name value".
+    size_t eq = arg.find('=');
+    if (eq != std::string::npos) {
+      value = arg.substr(eq + 1);
+      arg = arg.substr(0, eq);
+      has_value = true;
+    }
+
+    if (arg == "-h" || arg == "--help") {
+      options.help = true;
+      continue;
+    }
+    if (arg == "--sweep") {
+      options.sweep = true;
+      continue;
+    }
+    if (arg == "--tune") {
+      options.tune = true;
+      continue;
+    }
+    if (arg == "--retune") {
+      options.tune = true;
+      options.retune = true;
+      continue;
+    }
+    if (arg == "--gl-sync") {
+      options.gl_sync = true;
+      continue;
+    }
+    if (arg == "--split") {
+      options.split = true;
+      continue;
+    }
+    if (arg == "--fail-fast") {
+      options.fail_fast = true;
+      continue;
+    }
+    if (arg == "--huge-pages") {
+      options.huge_pages = true;
+      continue;
+    }
+    if (arg == "--mlock") {
+      options.lock_memory = true;
+      continue;
+    }
+    if (arg == "--profile") {
+      options.profile = true;
+      continue;
+    }
+    if (arg == "--list-devices") {
+      options.list_devices = true;
+      continue;
+    }
+
+    if (!has_value) {
+      if (i + 1 >= argc) {
+        error = "Missing value for " + arg;
+        return false;
+      }
+      value = argv[++i];
+    }
+
+    if (arg == "--device") {
+      options.device = value;
+    }
+    else if (arg == "--device-type") {
+      cl_device_type type = 0;
+      if (!ClContext::parseDeviceType(value, type)) {
+        error = "Invalid device type " + value;
+        return false;
+      }
+      options.device_types = value;
+    }
+    else if (arg == "--mode" || arg == "--strategy") {
+      options.modes = splitList(value);
+      for (size_t m = 0; m < options.modes.size(); m++) {
+        const std::string& mode = options.modes[m];
+        if (!isTransferStrategy(mode) && !(mode == "auto" && options.modes.size() == 1)) {
+          error = "Unknown transfer mode " + mode;
+          return false;
+        }
+      }
+      if (options.modes.empty()) {
+        error = "Empty transfer mode list";
+        return false;
+      }
+    }
+    else if (arg == "--sizes") {
+      if (!parseSizeList(value, options.sizes)) {
+        error = "Invalid size list " + value;
+        return false;
+      }
+    }
+    else if (arg == "--iterations") {
+      if (!parseInt(value, options.iterations) || options.iterations == 0) {
+        error = "Invalid iteration count " + value;
+        return false;
+      }
+    }
+    else if (arg == "--max-iterations") {
+      if (!parseInt(value, options.max_iterations)) {
+        error = "Invalid iteration count " + value;
+        return false;
+      }
+    }
+    else if (arg == "--confidence") {
+      if (!parseDouble(value, options.confidence)) {
+        error = "Invalid confidence target " + value;
+        return false;
+      }
+    }
+    else if (arg == "--warmup") {
+      if (!parseInt(value, options.warmup)) {
+        error = "Invalid warmup count " + value;
+        return false;
+      }
+    }
+    else if (arg == "--local-ws") {
+      if (!parseSize(value, options.local_ws)) {
+        error = "Invalid local work size " + value;
+        return false;
+      }
+    }
+    else if (arg == "--sweep-min") {
+      if (!parseSize(value, options.sweep_min)) {
+        error = "Invalid size " + value;
+        return false;
+      }
+    }
+    else if (arg == "--sweep-max") {
+      if (!parseSize(value, options.sweep_max)) {
+        error = "Invalid size " + value;
+        return false;
+      }
+    }
+    else if (arg == "--sweep-step") {
+      if (!parseDouble(value, options.sweep_step) || options.sweep_step <= 1.0) {
+        error = "The sweep step has to be larger than 1";
+        return false;
+      }
+    }
+    else if (arg == "--sweep-local-min") {
+      if (!parseSize(value, options.sweep_local_min)) {
+        error = "Invalid local work size " + value;
+        return false;
+      }
+    }
+    else if (arg == "--variants") {
+      options.variants = splitList(value);
+      for (size_t v = 0; v < options.variants.size(); v++) {
+        ClKernelVariant variant;
+        if (!ClKernelVariant::parse(options.variants[v], variant)) {
+          error = "Invalid kernel variant " + options.variants[v];
+          return false;
+        }
+      }
+    }
+    else if (arg == "--compute-iterations") {
+      if (!parseInt(value, options.compute_iterations)) {
+        error = "Invalid iteration count " + value;
+        return false;
+      }
+    }
+    else if (arg == "--tune-family") {
+      ClKernelVariant variant;
+      if (!ClKernelVariant::parse(value + ":float", variant)) {
+        error = "Unknown kernel family " + value;
+        return false;
+      }
+      options.tune_family = value;
+    }
+    else if (arg == "--tune-trials") {
+      if (!parseInt(value, options.tune_trials) || options.tune_trials == 0) {
+        error = "Invalid trial count " + value;
+        return false;
+      }
+    }
+    else if (arg == "--tuning-file") {
+      options.tuning_file = value;
+    }
+    else if (arg == "--pipeline") {
+      if (!parseInt(value, options.pipeline_depth) || options.pipeline_depth < 2 || options.pipeline_depth > 4) {
+        error = "The pipeline depth has to be 2, 3 or 4";
+        return false;
+      }
+    }
+    else if (arg == "--batch") {
+      if (!parseInt(value, options.batch_launches) || options.batch_launches < 1) {
+        error = "Invalid launch count " + value;
+        return false;
+      }
+    }
+    else if (arg == "--queues") {
+      if (!parseInt(value, options.batch_queues) || options.batch_queues < 1) {
+        error = "Invalid queue count " + value;
+        return false;
+      }
+    }
+    else if (arg == "--overhead") {
+      if (!parseInt(value, options.overhead_samples) || options.overhead_samples < 1) {
+        error = "Invalid sample count " + value;
+        return false;
+      }
+    }
+    else if (arg == "--devices") {
+      options.devices = splitList(value);
+      if (options.devices.empty()) {
+        error = "Empty device list";
+        return false;
+      }
+    }
+    else if (arg == "--sub-devices") {
+      if (!parseInt(value, options.sub_devices) || options.sub_devices < 2) {
+        error = "The sub-device count has to be at least 2";
+        return false;
+      }
+    }
+    else if (arg == "--seed") {
+      char* end = 0;
+      options.seed = strtoull(value.c_str(), &end, 10);
+      if (value.empty() || *end != '\0') {
+        error = "Invalid seed " + value;
+        return false;
+      }
+    }
+    else if (arg == "--input-fill") {
+      if (value != "mapped" && value != "host") {
+        error = "The input fill has to be mapped or host";
+        return false;
+      }
+      options.fill_mapped = value == "mapped";
+    }
+    else if (arg == "--mem-pool") {
+      if (!parseSize(value, options.mem_pool_arena)) {
+        error = "Invalid arena size " + value;
+        return false;
+      }
+    }
+    else if (arg == "--gl-backend") {
+      if (value != "auto" && value != "glx" && value != "egl" && value != "glfw" && value != "none") {
+        error = "The GL backend has to be auto, glx, egl, glfw or none";
+        return false;
+      }
+      options.gl_backend = value;
+    }
+    else if (arg == "--display") {
+      options.gl_displays = splitList(value);
+      if (options.gl_displays.empty()) {
+        error = "Empty display list";
+        return false;
+      }
+    }
+    else if (arg == "--kernel") {
+      options.kernel_file = value;
+    }
+    else if (arg == "--program-cache") {
+      options.program_cache = value;
+    }
+    else if (arg == "--build-report") {
+      options.build_report = value;
+    }
+    else if (arg == "--output") {
+      options.output = value;
+    }
+    else if (arg == "--device-profile") {
+      options.device_profile = value;
+    }
+    else if (arg == "--timeline") {
+      options.timeline = value;
+      options.profile = true;
+    }
+    else {
+      error = "Unknown option " + arg;
+      return false;
+    }
+  }
+
+  std::vector<std::string> run_modes = runModeOptions(options);
+  if (run_modes.size() > 1) {
+    error = "Only one of " + run_modes[0];
+    for (size_t r = 1; r < run_modes.size(); r++)
+      error += (r + 1 < run_modes.size() ? ", " : " and ") + run_modes[r];
+    error += " can be given";
+    return false;
+  }
+
+  if (options.gl_backend == "none" && optionsNeedGl(options)) {
+    error = options.gl_sync ? "--gl-sync needs a GL context, not --gl-backend none"
+                            : "--gl-backend none only runs the strategies without GL, e.g. --mode read";
+    return false;
+  }
+
+  if (options.max_iterations < options.iterations)
+    options.max_iterations = options.iterations;
+
+  return true;
+}
+
+void printBenchUsage(const char* program_name) {
+  std::cout
+    << "Usage: " << program_name << " [options]\n"
+    << "  --device <sel>      device index, name substring or type (gpu, cpu, accelerator). Default: 0\n"
+    << "  --device-type <list> enumerated device types: gpu, cpu, accelerator or all. GPUs come first. Default: all\n"
+    << "  --mode <list>       comma separated transfer strategies, also --strategy. Default: copy\n"
+    << "                      gl             CL writes into a shared GL buffer (acquire/release after glFinish)\n"
+    << "                      gl_fence       like gl, the acquire waits for a GL fence (cl_khr_gl_event) instead\n"
+    << "                      gl_implicit    like gl, cl_khr_gl_event synchronizes the acquire with GL implicitly\n"
+    << "                      copy           blocking read back + glBufferSubData\n"
+    << "                      read           blocking read back only, no GL\n"
+    << "                      pinned         CL_MEM_ALLOC_HOST_PTR output, mapped + glBufferSubData\n"
+    << "                      zero_copy      CL_MEM_USE_HOST_PTR output, mapped + glBufferSubData\n"
+    << "                      async_read     chunked non-blocking read back overlapped with the upload\n"
+    << "                      gl_persistent  read back into a persistently mapped GL buffer\n"
+    << "                      cl_copy        device to device copy baseline, no GL\n"
+    << "                      svm            coarse grained SVM buffers, mapped instead of read back, no GL\n"
+    << "                      svm_fine       fine grained SVM buffers, read by the host in place, no GL\n"
+    << "                      auto           picked from the device profile, no GL\n"
+    << "  --sizes <list>      comma separated float4 element counts, e.g. 64K,1M,16M. Default: 16M\n"
+    << "  --iterations <n>    minimum timed iterations per size. Default: 100\n"
+    << "  --confidence <rel>  keep sampling until the 95% CI of the mean is within +-rel, e.g. 0.01. Default: off\n"
+    << "  --max-iterations <n> upper bound for --confidence. Default: 1000\n"
+    << "  --warmup <n>        untimed iterations per size. Default: 5\n"
+    << "  --local-ws <n>      local work size. Default: 32\n"
+    << "  --sweep             sweep geometric sizes and power of two local sizes, ignores --sizes/--local-ws\n"
+    << "  --sweep-min <n>     smallest swept element count. Default: 256 (4 KiB)\n"
+    << "  --sweep-max <n>     largest swept element count. Default: CL_DEVICE_MAX_MEM_ALLOC_SIZE limit\n"
+    << "  --sweep-step <f>    growth factor between swept sizes. Default: 2\n"
+    << "  --sweep-local-min <n> smallest swept local size, up to CL_KERNEL_WORK_GROUP_SIZE. Default: 16\n"
+    << "  --variants <list>   compare kernel specializations: element type (float, float4, float8, float16, int, ...)\n"
+    << "                      and an optional xN for N elements per work-item, e.g. float4,float16,float4x4\n"
+    << "                      A family: prefix selects the kernel: copy (default), stride (grid-stride loop),\n"
+    << "                      vload (vloadn/vstoren), local (async_work_group_copy), compute (multiply-adds)\n"
+    << "  --compute-iterations <n> multiply-adds per element of the compute variants. Default: 64\n"
+    << "  --tune              run every strategy and size on the tuned vector width, elements per work-item\n"
+    << "                      and local size. Stored configurations of the device are reused without measuring\n"
+    << "  --retune            like --tune, but always measures and replaces the stored configurations\n"
+    << "  --tune-family <f>   kernel family to tune: copy, stride, vload, local or compute. Default: copy\n"
+    << "  --tune-trials <n>   timed launches per tuning candidate. Default: 5\n"
+    << "  --tuning-file <file> stored tuned configurations, --tuning-file= to disable. Default: cl_tuning.txt\n"
+    << "  --pipeline <n>      pipelined loop with n (2-4) frames in flight, compared against the serialised loop.\n"
+    << "                      Every frame is moved by the --mode strategies, each frame on a queue of its own\n"
+    << "  --gl-sync           compare the GL-CL synchronization of gl, gl_fence and gl_implicit: latency and\n"
+    << "                      back to back throughput relative to the glFinish/clFinish path. Ignores --mode\n"
+    << "  --batch <n>         cut every size into n write/kernel/read chains and compare their submission:\n"
+    << "                      clFinish per command, one in-order queue, one out-of-order queue with events\n"
+    << "                      and several in-order queues. Ignores --mode\n"
+    << "  --queues <n>        in-order queues of the --batch multi-queue scheme. Default: 2\n"
+    << "  --overhead <n>      fixed costs with n samples each and their percentiles: empty kernel launch,\n"
+    << "                      enqueue, clSetKernelArg, clFinish, event callback, GL acquire/release and\n"
+    << "                      4 B to 64 KiB read, write and map. Ignores --mode. Without a GL context\n"
+    << "                      (or with --gl-backend none) acquire/release is skipped\n"
+    << "  --devices <list>    run on several devices solo and concurrently, comma separated selectors or \"all\".\n"
+    << "                      GL strategies need a GL context of its own for every device, see --display\n"
+    << "  --split             with --devices, also split every size across the devices by their solo bandwidth\n"
+    << "  --sub-devices <n>   partition every CPU device into n equal sub-devices, e.g. one per NUMA node\n"
+    << "  --kernel <file>     kernel source file. Default: testKernel.cl\n"
+    << "  --program-cache <dir> program binary cache directory, --program-cache= to disable. Default: cl_cache\n"
+    << "  --build-report <file> JSON file with the log, duration and options of every program build\n"
+    << "  --fail-fast         exit on the first program that does not build\n"
+    << "  --output <file>     JSON result file, \"-\" for stdout. Default: bench_results.json\n"
+    << "                      With any report on stdout, the progress output goes to stderr\n"
+    << "  --seed <n>          seed of the input data, the same seed gives the same data everywhere. Default: 1\n"
+    << "  --input-fill <how>  mapped: generate the input into the mapped device buffer, host: into host memory\n"
+    << "                      and write it. Default: mapped\n"
+    << "  --mem-pool <bytes>  sub-allocate the device buffers from pooled arenas of this size, e.g. 512M\n"
+    << "  --huge-pages        back the host staging buffers with huge pages (explicit, else transparent)\n"
+    << "  --mlock             lock the host staging buffers into memory\n"
+    << "  --gl-backend <b>    OpenGL context of the GL strategies: glx (X window), egl (pbuffer or surfaceless,\n"
+    << "                      no X needed), glfw (Windows) or none. No context is created if all strategies run\n"
+    << "                      without GL. Default: auto, glx if an X display is set, else egl\n"
+    << "                      egl needs a GLEW built with GLEW_EGL, or a GLX build on libglvnd\n"
+    << "  --display <list>    one GL context per entry: X displays of glx, e.g. :0.0,:0.1, or EGL device indices\n"
+    << "                      of egl, e.g. 0,1. Every device is bound to the context rendering on it if there is\n"
+    << "                      one. Default: one context on $DISPLAY or the default EGL display\n"
+    << "  --profile           enable OpenCL event profiling for the per stage times\n"
+    << "  --timeline <file>   JSON file with the per-iteration stage timestamps, implies --profile\n"
+    << "  --device-profile <file> JSON file with the capability profile of every device\n"
+    << "  --list-devices      print the detected devices and exit\n"
+    << "  -h, --help          print this message\n";
+}
@@ -0,0 +1,91 @@
+#ifndef __BENCH_OPTIONS_H__
+#define __BENCH_OPTIONS_H__
+
+// STD
+#include <vector>
+#include <string>
+
+// Command line configuration of the benchmark driver.
+struct BenchOptions {
+  std::string         device;         // index, device name (sub)string or type: gpu, cpu, accelerator
+  std::string         device_types;   // enumerated device types: comma separated gpu, cpu, accelerator or all
+  std::vector<std::string> modes;     // names of the transfer strategies, see TransferStrategy.cpp, "auto" picks them by the device profile
+  std::vector<size_t> sizes;          // number of cl_float4 elements for each run
+  int                 iterations;     // minimum number of timed iterations
+  int                 max_iterations; // upper bound when sampling until the confidence target is met
+  double              confidence;     // target relative 95% CI half width of the mean time, 0 to disable
+  int                 warmup;
+  size_t              local_ws;
+  std::string         kernel_file;
+  std::string         program_cache;  // directory of the program binary cache, empty to always build from source
+  std::string         build_report;   // JSON file with the log, duration and options of every build, empty to disable
+  bool                fail_fast;      // exit on the first program that does not build
+  std::string         output;         // "-" writes the results to stdout
+  std::string         timeline;       // per-iteration breakdown, empty to disable
+  std::string         device_profile; // JSON file with the capability profile of every device, empty to disable
+
+  // sweep over geometric element counts and power of two local sizes instead of sizes/local_ws
+  bool                sweep;
+  size_t              sweep_min;        // elements
+  size_t              sweep_max;        // elements, 0: limited by the device memory
+  double              sweep_step;       // growth factor between two sizes
+  size_t              sweep_local_min;
+
+  std::vector<std::string> variants;   // kernel variants to compare, e.g. float4, float16x4, see ClKernelVariant::parse
+  int                 compute_iterations; // multiply-adds per element of the compute variants
+
+  // auto-tuned launch configuration instead of local_ws, see AutoTuner
+  bool                tune;
+  std::string         tune_family;      // kernel family to tune, see ClKernelVariant
+  std::string         tuning_file;      // stored configurations, empty to always measure
+  bool                retune;           // measure even if the tuning file has a configuration
+  int                 tune_trials;      // timed launches per candidate
+
+  int                 pipeline_depth;   // > 0: pipelined producer/consumer loop with this many frames in flight
+  bool                gl_sync;          // compare the GL-CL synchronization of the interop path, see GlSyncBenchmark
+  int                 batch_launches;   // > 0: compare the submission schemes of this many small launches, see BatchedBenchmark
+  int                 batch_queues;     // in-order queues of the multi-queue scheme
+  int                 overhead_samples; // > 0: fixed cost microbenchmarks with this many samples each, see OverheadBenchmark
+
+  // multi-device run: selectors of the devices, "all" for every device
+  std::vector<std::string> devices;
+  bool                split;            // also split one buffer across the devices
+  int                 sub_devices;      // > 0: partition every CPU device into this many sub-devices
+
+  unsigned long long  seed;             // of the input data, see InputGenerator
+  bool                fill_mapped;      // generate the input into the mapped device buffer, not into host staging memory
+  size_t              mem_pool_arena;   // bytes, > 0: device buffers are sub-allocated from arenas, see ClMemPool
+
+  // host staging memory, see HostBufferPool
+  bool                huge_pages;
+  bool                lock_memory;
+
+  std::string         gl_backend;       // OpenGL context of the GL strategies: auto, glx, egl, glfw or none, see GlBackend
+  std::vector<std::string> gl_displays; // one GL context each: X displays of glx, EGL device indices of egl. Empty for one default context
+
+  bool                profile;        // create the queues with CL_QUEUE_PROFILING_ENABLE
+
+  bool                list_devices;
+  bool                help;
+
+  BenchOptions();
+};
+
+bool parseBenchOptions(int argc, char** argv, BenchOptions& options, std::string& error);
+void printBenchUsage(const char* program_name);
+
+// parses "4096", "64K", "16M" or "1G" into a count.
+bool parseSize(const std::string& str, size_t& size);
+
+// true, if one of the transfer strategies needs a current OpenGL context.
+bool modesNeedGl(const std::vector<std::string>& modes);
+
+// The run mode options given: --gl-sync, --batch, --overhead, --pipeline, --sweep, --tune, --variants.
+// parseBenchOptions accepts at most one of them.
+std::vector<std::string> runModeOptions(const BenchOptions& options);
+
+// true, if the selected run needs a current OpenGL context: --gl-sync always, --batch never,
+// --overhead unless --gl-backend none, all other runs if one of the modes does.
+bool optionsNeedGl(const BenchOptions& options);
+
+#endif
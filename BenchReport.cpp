@@ -0,0 +1,134 @@
+#include "BenchReport.h"
+
+// STD
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <math.h>
+
+std::string jsonEscape(const std::string& str) {
+  std::string escaped;
+  escaped.reserve(str.size() + 2);
+  for (size_t i = 0; i < str.size(); i++) {
+    char c = str[i];
+    switch (c) {
+      case '"':   escaped += "\\\""; break;
+      case '\\':  escaped += "\\\\"; break;
+      case '\n':  escaped += "\\n";  break;
+      case '\t':  escaped += "\\t";  break;
+      case '\r':  escaped += "\\r";  break;
+      default:
+        // device names are queried with their terminating zero.
+        if (c == '\0')
+          break;
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char buf[8];
+          sprintf(buf, "\\u%04x", c);
+          escaped += buf;
+        }
+        else
+          escaped += c;
+    }
+  }
+  return escaped;
+}
+
+void BenchRecord::setRaw(const std::string& key, const std::string& json_value) {
+  for (size_t i = 0; i < m_fields.size(); i++) {
+    if (m_fields[i].first == key) {
+      m_fields[i].second = json_value;
+      return;
+    }
+  }
+  m_fields.push_back(std::make_pair(key, json_value));
+}
+
+void BenchRecord::set(const std::string& key, const std::string& value) {
+  setRaw(key, "\"" + jsonEscape(value) + "\"");
+}
+
+void BenchRecord::set(const std::string& key, const char* value) {
+  set(key, std::string(value));
+}
+
+void BenchRecord::set(const std::string& key, double value) {
+  // JSON has no representation for inf/nan.
+  if (value != value || fabs(value) > 1.0e300) {
+    setRaw(key, "null");
+    return;
+  }
+  std::ostringstream ss;
+  ss.precision(9);
+  ss << value;
+  setRaw(key, ss.str());
+}
+
+void BenchRecord::set(const std::string& key, long long value) {
+  std::ostringstream ss;
+  ss << value;
+  setRaw(key, ss.str());
+}
+
+void BenchRecord::set(const std::string& key, int value) {
+  set(key, static_cast<long long>(value));
+}
+
+void BenchRecord::set(const std::string& key, size_t value) {
+  set(key, static_cast<long long>(value));
+}
+
+void BenchRecord::set(const std::string& key, bool value) {
+  setRaw(key, value ? "true" : "false");
+}
+
+std::string BenchRecord::toJson() const {
+  std::string json = "{";
+  for (size_t i = 0; i < m_fields.size(); i++) {
+    if (i > 0)
+      json += ", ";
+    json += "\"" + jsonEscape(m_fields[i].first) + "\": " + m_fields[i].second;
+  }
+  json += "}";
+  return json;
+}
+
+void BenchReport::add(const BenchRecord& record) {
+  records.push_back(record);
+}
+
+// stdout of the reports, 0 for std::cout
+static FILE* report_stdout = 0;
+
+void BenchReport::setStdout(FILE* stream) {
+  report_stdout = stream;
+}
+
+bool BenchReport::write(const std::string& path) const {
+  std::ofstream file;
+  std::ostringstream redirected;
+  if (path != "-") {
+    file.open(path.c_str());
+    if (!file) {
+      std::cerr << "Cannot open " << path << std::endl;
+      return false;
+    }
+  }
+  std::ostream& out = (path != "-") ? static_cast<std::ostream&>(file)
+                                    : report_stdout ? static_cast<std::ostream&>(redirected) : std::cout;
+
+  out << "{\n  \"runs\": [\n";
+  for (size_t i = 0; i < records.size(); i++) {
+    out << "    " << records[i].toJson();
+    if (i + 1 < records.size())
+      out << ",";
+    out << "\n";
+  }
+  out << "  ]\n}\n";
+
+  if (path == "-" && report_stdout) {
+    std::string json = redirected.str();
+    return fwrite(json.data(), 1, json.size(), report_stdout) == json.size() && fflush(report_stdout) == 0;
+  }
+  return !out.fail();
+}
@@ -0,0 +1,45 @@
+#ifndef __BENCH_REPORT_H__
+#define __BENCH_REPORT_H__
+
+// STD
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include <utility>
+
+// One result row. Keys keep their insertion order in the output.
+class BenchRecord {
+public:
+  void set(const std::string& key, const std::string& value);
+  void set(const std::string& key, const char* value);
+  void set(const std::string& key, double value);
+  void set(const std::string& key, long long value);
+  void set(const std::string& key, int value);
+  void set(const std::string& key, size_t value);
+  void set(const std::string& key, bool value);
+
+  std::string toJson() const;
+
+private:
+  void setRaw(const std::string& key, const std::string& json_value);
+
+  std::vector< std::pair<std::string, std::string> > m_fields;
+};
+
+// Collects the records of a benchmark plan and writes them as one JSON document.
+class BenchReport {
+public:
+  void add(const BenchRecord& record);
+
+  // "-" writes to stdout, or to the stream given to setStdout.
+  bool write(const std::string& path) const;
+
+  // Reports written to "-" go to stream, once stdout itself carries the progress output elsewhere.
+  static void setStdout(FILE* stream);
+
+  std::vector<BenchRecord> records;
+};
+
+std::string jsonEscape(const std::string& str);
+
+#endif
@@ -0,0 +1,127 @@
+#include "BenchStats.h"
+
+// STD
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+SampleStats::SampleStats() :
+  count(0), outliers(0),
+  min(0.0), median(0.0), p90(0.0), p99(0.0), max(0.0),
+  mean(0.0), mean_filtered(0.0), stddev(0.0), cv(0.0), ci95_rel(0.0) {
+}
+
+double percentile(const std::vector<double>& sorted_samples, double p) {
+  if (sorted_samples.empty())
+    return 0.0;
+  double rank = p * (sorted_samples.size() - 1);
+  size_t lo = static_cast<size_t>(floor(rank));
+  size_t hi = std::min(lo + 1, sorted_samples.size() - 1);
+  double frac = rank - lo;
+  return sorted_samples[lo] + (sorted_samples[hi] - sorted_samples[lo]) * frac;
+}
+
+double studentT95(size_t dof) {
+  static const double table[] = {
+    0.0,    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+    2.228,  2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093,
+    2.086,  2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045,
+    2.042
+  };
+  if (dof == 0)
+    return 0.0;
+  if (dof < sizeof(table) / sizeof(table[0]))
+    return table[dof];
+  return 1.96;
+}
+
+SampleStats computeStats(std::vector<double> samples) {
+  SampleStats stats;
+  stats.count = samples.size();
+  if (samples.empty())
+    return stats;
+
+  std::sort(samples.begin(), samples.end());
+  stats.min    = samples.front();
+  stats.max    = samples.back();
+  stats.median = percentile(samples, 0.50);
+  stats.p90    = percentile(samples, 0.90);
+  stats.p99    = percentile(samples, 0.99);
+
+  double sum = 0.0;
+  for (size_t i = 0; i < samples.size(); i++)
+    sum += samples[i];
+  stats.mean = sum / samples.size();
+
+  double sq_sum = 0.0;
+  for (size_t i = 0; i < samples.size(); i++)
+    sq_sum += (samples[i] - stats.mean) * (samples[i] - stats.mean);
+  stats.stddev = samples.size() > 1 ? sqrt(sq_sum / (samples.size() - 1)) : 0.0;
+  stats.cv = stats.mean > 0.0 ? stats.stddev / stats.mean : 0.0;
+
+  if (samples.size() > 1 && stats.mean > 0.0)
+    stats.ci95_rel = studentT95(samples.size() - 1) * stats.stddev / sqrt(static_cast<double>(samples.size())) / stats.mean;
+
+  // Tukey fences
+  double q1 = percentile(samples, 0.25);
+  double q3 = percentile(samples, 0.75);
+  double lo_fence = q1 - 1.5 * (q3 - q1);
+  double hi_fence = q3 + 1.5 * (q3 - q1);
+
+  double filtered_sum = 0.0;
+  size_t filtered_count = 0;
+  for (size_t i = 0; i < samples.size(); i++) {
+    if (samples[i] < lo_fence || samples[i] > hi_fence) {
+      stats.outliers++;
+      continue;
+    }
+    filtered_sum += samples[i];
+    filtered_count++;
+  }
+  stats.mean_filtered = filtered_count ? filtered_sum / filtered_count : stats.mean;
+
+  return stats;
+}
+
+RunningStats::RunningStats() :
+  m_count(0), m_mean(0.0), m_m2(0.0) {
+}
+
+void RunningStats::add(double value) {
+  m_count++;
+  double delta = value - m_mean;
+  m_mean += delta / m_count;
+  m_m2 += delta * (value - m_mean);
+}
+
+double RunningStats::variance() const {
+  return m_count > 1 ? m_m2 / (m_count - 1) : 0.0;
+}
+
+double RunningStats::ci95Rel() const {
+  // one sample has no spread: not converged, whatever the target.
+  if (m_count < 2)
+    return std::numeric_limits<double>::infinity();
+  if (m_mean <= 0.0)
+    return 0.0;
+  return studentT95(m_count - 1) * sqrt(variance() / m_count) / m_mean;
+}
+
+double bandwidthGBs(double bytes, double time_ms) {
+  return time_ms > 0.0 ? bytes / (time_ms * 1.0e6) : 0.0;
+}
+
+void setStats(BenchRecord& record, const std::string& prefix, const std::string& unit, const SampleStats& stats) {
+  record.set(prefix + "samples",            stats.count);
+  record.set(prefix + "outliers",           stats.outliers);
+  record.set(prefix + "min" + unit,         stats.min);
+  record.set(prefix + "median" + unit,      stats.median);
+  record.set(prefix + "p90" + unit,         stats.p90);
+  record.set(prefix + "p99" + unit,         stats.p99);
+  record.set(prefix + "max" + unit,         stats.max);
+  record.set(prefix + "mean" + unit,        stats.mean);
+  record.set(prefix + "mean_filtered" + unit, stats.mean_filtered);
+  record.set(prefix + "stddev" + unit,      stats.stddev);
+  record.set(prefix + "cv",                 stats.cv);
+  record.set(prefix + "ci95_rel",           stats.ci95_rel);
+}
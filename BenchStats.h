@@ -0,0 +1,59 @@
+#ifndef __BENCH_STATS_H__
+#define __BENCH_STATS_H__
+
+// STD
+#include <vector>
+#include <string>
+
+#include "BenchReport.h"
+
+// Summary of a set of timing samples (all values in the unit of the samples).
+struct SampleStats {
+  size_t  count;
+  size_t  outliers;       // samples outside the Tukey fences (1.5 * IQR)
+  double  min;
+  double  median;
+  double  p90;
+  double  p99;
+  double  max;
+  double  mean;
+  double  mean_filtered;  // mean without the outliers
+  double  stddev;
+  double  cv;             // stddev / mean
+  double  ci95_rel;       // half width of the 95% confidence interval of the mean, relative to the mean
+
+  SampleStats();
+};
+
+SampleStats computeStats(std::vector<double> samples);
+
+// Linear interpolation between the closest ranks, samples must be sorted.
+double percentile(const std::vector<double>& sorted_samples, double p);
+
+// Two sided 95% Student t quantile for the given degrees of freedom.
+double studentT95(size_t dof);
+
+// Running mean/variance (Welford) to decide cheaply when to stop sampling.
+class RunningStats {
+public:
+  RunningStats();
+
+  void    add(double value);
+  size_t  count() const { return m_count; }
+  double  mean() const { return m_mean; }
+  double  variance() const;
+  double  ci95Rel() const;   // infinity below two samples
+
+private:
+  size_t  m_count;
+  double  m_mean;
+  double  m_m2;
+};
+
+// GB/s for bytes moved in time_ms, 0 if the time is not positive.
+double bandwidthGBs(double bytes, double time_ms);
+
+// Adds <prefix>min, <prefix>median, ... fields with the given unit suffix, e.g. "_ms".
+void setStats(BenchRecord& record, const std::string& prefix, const std::string& unit, const SampleStats& stats);
+
+#endif
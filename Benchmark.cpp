@@ -0,0 +1,357 @@
+#include "Benchmark.h"
+#include "ClProfiling.h"
+#include "DeviceProfile.h"
+#include "AutoTuner.h"
+
+// STD
+#include <iostream>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <stdlib.h>
+
+void setTransferKernelArgs(cl_kernel mykernel, TransferStrategy& strategy, size_t mem_size, size_t local_ws, const ClKernelVariant& variant) {
+  cl_int count = static_cast<cl_int>(variant.count(mem_size * sizeof(cl_float4)));
+  strategy.setKernelArgs(mykernel);
+  clSetKernelArg(mykernel, 2, sizeof(cl_int), &count);
+  if (variant.localMemBytes(local_ws) > 0)
+    clSetKernelArg(mykernel, 3, variant.localMemBytes(local_ws), nullptr);
+}
+
+bool runTransferIteration(ClContext* cl, const ClDevice& device, cl_kernel mykernel, TransferStrategy& strategy,
+                          size_t mem_size, size_t local_ws, IterationTiming& timing, const ClKernelVariant& variant) {
+  cl_int error;
+  size_t work_items = variant.workItems(mem_size * sizeof(cl_float4));
+  size_t global_ws = (work_items + local_ws - 1) / local_ws * local_ws;
+  IterationEvents events((device.queue_properties & CL_QUEUE_PROFILING_ENABLE) != 0);
+  HostClock::time_point beg_time = HostClock::now();
+
+  strategy.beforeKernel(events, timing);
+  error = clEnqueueNDRangeKernel(device.cmd_queue, mykernel, 1, nullptr, &global_ws, &local_ws, 0, nullptr, events(events.kernel)); cl->checkError(error);
+  strategy.transfer(mem_size, events, timing);
+
+  // launch failures such as CL_OUT_OF_RESOURCES may only show up when the queue is finished.
+  cl_int finish_error = clFinish(device.cmd_queue); cl->checkError(finish_error);
+  timing.wall_ms = elapsedMs(beg_time, HostClock::now());
+  events.collect(timing);
+  return error == CL_SUCCESS && finish_error == CL_SUCCESS;
+}
+
+BenchRecord runTransferBenchmark(ClContext* cl, const ClDevice& device, cl_kernel mykernel, const BenchOptions& options,
+                                 TransferStrategy& strategy, size_t mem_size, size_t local_ws, BenchReport* timeline, SampleStats* stats,
+                                 const ClKernelVariant& variant) {
+  std::cout << "Device: " << device.features.device_name << ", mode: " << strategy.name() << ", variant: " << variant.name()
+            << ", elements: " << mem_size << ", local ws: " << local_ws << std::endl;
+
+  setTransferKernelArgs(mykernel, strategy, mem_size, local_ws, variant);
+
+  bool profile = (device.queue_properties & CL_QUEUE_PROFILING_ENABLE) != 0;
+
+  // sums over the timed iterations
+  double gl_finish_ms = 0.0, upload_ms = 0.0;
+  double acquire_ms = 0.0, kernel_ms = 0.0, read_ms = 0.0, release_ms = 0.0;
+  std::vector<double> wall_samples, kernel_samples;
+  RunningStats running;
+  bool converged = options.confidence <= 0.0;
+
+  for (int i = 0; ; i++){
+    int n_timed = i - options.warmup;
+    if (n_timed >= options.max_iterations)
+      break;
+    if (n_timed >= options.iterations){
+      if (options.confidence <= 0.0)
+        break;
+      if (running.ci95Rel() <= options.confidence){
+        converged = true;
+        break;
+      }
+    }
+
+    IterationTiming timing;
+    runTransferIteration(cl, device, mykernel, strategy, mem_size, local_ws, timing, variant);
+
+    if (i < options.warmup)
+      continue;
+
+    if (timeline){
+      BenchRecord row = timing.toRecord(n_timed);
+      row.set("mode", strategy.name());
+      row.set("elements", mem_size);
+      row.set("local_ws", local_ws);
+      timeline->add(row);
+    }
+
+    wall_samples.push_back(timing.wall_ms);
+    running.add(timing.wall_ms);
+    if (profile)
+      kernel_samples.push_back(timing.kernel.durationMs());
+
+    gl_finish_ms  += timing.gl_finish_ms;
+    upload_ms     += timing.upload_ms;
+    acquire_ms    += timing.acquire.durationMs();
+    kernel_ms     += timing.kernel.durationMs();
+    read_ms       += timing.read.durationMs();
+    release_ms    += timing.release.durationMs();
+  }
+
+  size_t n_samples = wall_samples.size();
+  SampleStats wall_stats = computeStats(wall_samples);
+  if (stats)
+    *stats = wall_stats;
+
+  // every element is read once and written once.
+  double bytes_moved = 2.0 * mem_size * sizeof(cl_float4);
+
+  std::cout << "Execution Time (Median) = " << wall_stats.median << " ms, p99 = " << wall_stats.p99
+            << " ms, cv = " << wall_stats.cv << ", samples = " << n_samples << std::endl;
+
+  BenchRecord record;
+  record.set("device", device.features.device_name);
+  record.set("platform", device.features.platform_name);
+  record.set("mode", strategy.name());
+  record.set("variant", variant.name());
+  record.set("kernel", variant.kernelName());
+  record.set("build_options", variant.buildOptions());
+  record.set("elements", mem_size);
+  record.set("bytes", mem_size * sizeof(cl_float4));
+  record.set("local_ws", local_ws);
+  record.set("seed", static_cast<long long>(options.seed));
+  record.set("warmup", options.warmup);
+  record.set("iterations", n_samples);
+  record.set("profiling", profile);
+  record.set("confidence_target", options.confidence);
+  record.set("converged", converged);
+  setStats(record, "", "_ms", wall_stats);
+  record.set("bandwidth_gbs", bandwidthGBs(bytes_moved, wall_stats.median));
+  record.set("bandwidth_peak_gbs", bandwidthGBs(bytes_moved, wall_stats.min));
+  record.set("iterations_per_sec", wall_stats.mean > 0.0 ? 1000.0 / wall_stats.mean : 0.0);
+  record.set("avg_gl_finish_ms", gl_finish_ms / n_samples);
+  record.set("avg_upload_ms", upload_ms / n_samples);
+  if (profile){
+    record.set("avg_acquire_ms", acquire_ms / n_samples);
+    record.set("avg_kernel_ms",  kernel_ms  / n_samples);
+    record.set("avg_read_ms",    read_ms    / n_samples);
+    record.set("avg_release_ms", release_ms / n_samples);
+
+    SampleStats kernel_stats = computeStats(kernel_samples);
+    setStats(record, "kernel_", "_ms", kernel_stats);
+    record.set("kernel_bandwidth_gbs", bandwidthGBs(bytes_moved, kernel_stats.median));
+  }
+
+  // roofline coordinates of the compute family
+  if (variant.flopsPerElement() > 0.0){
+    double flops = variant.flopsPerElement() * variant.count(mem_size * sizeof(cl_float4));
+    double time_ms = profile ? computeStats(kernel_samples).median : wall_stats.median;
+    record.set("arithmetic_intensity", flops / bytes_moved);
+    record.set("gflops", time_ms > 0.0 ? flops / (time_ms * 1.0e6) : 0.0);
+  }
+
+  return record;
+}
+
+void runSizeList(ClContext* cl, const ClDevice& device, cl_kernel kernel, const BenchOptions& options, BenchReport& report, BenchReport* timeline) {
+  size_t capacity = *std::max_element(options.sizes.begin(), options.sizes.end());
+
+  for (size_t m = 0; m < options.modes.size(); m++){
+    TransferStrategy* strategy = createTransferStrategy(options.modes[m]);
+    if (strategy->create(cl, device, capacity, options.seed, options.fill_mapped)){
+      for (size_t s = 0; s < options.sizes.size(); s++)
+        report.add(runTransferBenchmark(cl, device, kernel, options, *strategy, options.sizes[s], options.local_ws, timeline));
+    }
+    else
+      std::cerr << "Cannot create the " << options.modes[m] << " transfer strategy.\n";
+    strategy->release();
+    delete strategy;
+  }
+}
+
+void runVariants(ClContext* cl, const ClDevice& device, const BenchOptions& options, BenchReport& report, BenchReport* timeline) {
+  std::vector<ClKernelVariant> variants(options.variants.size());
+  std::vector<cl_kernel> kernels(options.variants.size());
+  for (size_t v = 0; v < options.variants.size(); v++){
+    kernels[v] = 0;
+    if (!ClKernelVariant::parse(options.variants[v], variants[v])){
+      std::cerr << "Skipping the invalid kernel variant " << options.variants[v] << std::endl;
+      continue;
+    }
+    variants[v].setComputeIterations(options.compute_iterations);
+    kernels[v] = cl->createKernel(options.kernel_file, variants[v], variants[v].kernelName(), device);
+  }
+
+  size_t capacity = *std::max_element(options.sizes.begin(), options.sizes.end());
+  for (size_t m = 0; m < options.modes.size(); m++){
+    TransferStrategy* strategy = createTransferStrategy(options.modes[m]);
+    if (!strategy->create(cl, device, capacity, options.seed, options.fill_mapped)){
+      std::cerr << "Cannot create the " << options.modes[m] << " transfer strategy.\n";
+      strategy->release();
+      delete strategy;
+      continue;
+    }
+
+    for (size_t s = 0; s < options.sizes.size(); s++){
+      int best = -1;
+      double best_median = 0.0;
+      for (size_t v = 0; v < variants.size(); v++){
+        if (!kernels[v])
+          continue;
+        SampleStats stats;
+        report.add(runTransferBenchmark(cl, device, kernels[v], options, *strategy, options.sizes[s], options.local_ws, timeline, &stats, variants[v]));
+        if (best < 0 || stats.median < best_median){
+          best = static_cast<int>(v);
+          best_median = stats.median;
+        }
+      }
+      if (best < 0)
+        continue;
+
+      BenchRecord record;
+      record.set("device", device.features.device_name);
+      record.set("mode", options.modes[m]);
+      record.set("elements", options.sizes[s]);
+      record.set("best_variant", variants[best].name());
+      record.set("best_build_options", variants[best].buildOptions());
+      record.set("bandwidth_gbs", bandwidthGBs(2.0 * options.sizes[s] * sizeof(cl_float4), best_median));
+      report.add(record);
+      std::cout << "  " << options.modes[m] << "\t" << options.sizes[s] << " elements\tfastest variant " << variants[best].name() << "\n";
+    }
+
+    strategy->release();
+    delete strategy;
+  }
+
+  for (size_t v = 0; v < kernels.size(); v++){
+    if (kernels[v])
+      clReleaseKernel(kernels[v]);
+  }
+}
+
+void runTuned(ClContext* cl, const ClDevice& device, const BenchOptions& options, BenchReport& report, BenchReport* timeline) {
+  AutoTuner tuner(options.tuning_file);
+  size_t capacity = *std::max_element(options.sizes.begin(), options.sizes.end());
+
+  for (size_t m = 0; m < options.modes.size(); m++){
+    TransferStrategy* strategy = createTransferStrategy(options.modes[m]);
+    if (!strategy->create(cl, device, capacity, options.seed, options.fill_mapped)){
+      std::cerr << "Cannot create the " << options.modes[m] << " transfer strategy.\n";
+      strategy->release();
+      delete strategy;
+      continue;
+    }
+
+    for (size_t s = 0; s < options.sizes.size(); s++){
+      TunedConfig config;
+      if (!tuner.tune(cl, device, options, *strategy, options.sizes[s], config, &report)){
+        std::cerr << "No " << options.tune_family << " configuration runs on " << device.features.device_name << std::endl;
+        continue;
+      }
+      cl_kernel kernel = cl->createKernel(options.kernel_file, config.variant, config.variant.kernelName(), device);
+      if (!kernel)
+        continue;
+
+      BenchRecord record = runTransferBenchmark(cl, device, kernel, options, *strategy, options.sizes[s], config.local_ws, timeline, nullptr, config.variant);
+      record.set("tuned", true);
+      record.set("tuning_stored", config.stored);
+      report.add(record);
+      clReleaseKernel(kernel);
+    }
+
+    strategy->release();
+    delete strategy;
+  }
+}
+
+void runSweep(ClContext* cl, const ClDevice& device, cl_kernel kernel, const BenchOptions& options, BenchReport& report, BenchReport* timeline) {
+  cl_int error;
+
+  size_t max_elements = maxFittingSize(device.features);
+  if (options.sweep_max > 0)
+    max_elements = std::min(max_elements, options.sweep_max);
+
+  size_t max_local_ws = 0;
+  error = clGetKernelWorkGroupInfo(kernel, device.id, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &max_local_ws, nullptr); cl->checkError(error);
+
+  std::vector<size_t> sizes;
+  for (double s = static_cast<double>(options.sweep_min); s <= max_elements; s *= options.sweep_step){
+    size_t size = static_cast<size_t>(s);
+    if (sizes.empty() || sizes.back() != size)
+      sizes.push_back(size);
+  }
+
+  std::vector<size_t> local_sizes;
+  for (size_t l = options.sweep_local_min; l <= max_local_ws; l *= 2)
+    local_sizes.push_back(l);
+
+  if (sizes.empty() || local_sizes.empty()){
+    std::cerr << "Empty sweep: " << max_elements << " max elements, " << max_local_ws << " max local work size.\n";
+    return;
+  }
+
+  std::cout << "Sweep: " << sizes.size() << " sizes (" << sizes.front() << " - " << sizes.back() << " elements), "
+            << local_sizes.size() << " local sizes (" << local_sizes.front() << " - " << local_sizes.back() << ")\n";
+
+  // best median time of every (mode, size) over all local sizes
+  std::map< std::string, std::map<size_t, double> > best_time;
+
+  for (size_t m = 0; m < options.modes.size(); m++){
+    const std::string& mode = options.modes[m];
+    TransferStrategy* strategy = createTransferStrategy(mode);
+    if (!strategy->create(cl, device, sizes.back(), options.seed, options.fill_mapped)){
+      std::cerr << "Cannot create the " << mode << " transfer strategy.\n";
+      strategy->release();
+      delete strategy;
+      continue;
+    }
+
+    for (size_t s = 0; s < sizes.size(); s++){
+      size_t best_local_ws = 0;
+      double best_median = 0.0;
+
+      for (size_t l = 0; l < local_sizes.size(); l++){
+        SampleStats stats;
+        BenchRecord record = runTransferBenchmark(cl, device, kernel, options, *strategy, sizes[s], local_sizes[l], timeline, &stats);
+        record.set("sweep", true);
+        report.add(record);
+
+        if (best_local_ws == 0 || stats.median < best_median){
+          best_local_ws = local_sizes[l];
+          best_median = stats.median;
+        }
+      }
+
+      best_time[mode][sizes[s]] = best_median;
+      std::cout << "  " << mode << "\t" << sizes[s] << " elements\tbest local ws " << best_local_ws
+                << "\t" << bandwidthGBs(2.0 * sizes[s] * sizeof(cl_float4), best_median) << " GB/s\n";
+    }
+
+    strategy->release();
+    delete strategy;
+  }
+
+  // Crossover: the smallest size from which mode a stays faster than mode b.
+  for (size_t a = 0; a < options.modes.size(); a++){
+    for (size_t b = 0; b < options.modes.size(); b++){
+      if (a == b || !best_time.count(options.modes[a]) || !best_time.count(options.modes[b]))
+        continue;
+      const std::map<size_t, double>& time_a = best_time[options.modes[a]];
+      const std::map<size_t, double>& time_b = best_time[options.modes[b]];
+
+      size_t crossover = 0;
+      for (std::map<size_t, double>::const_reverse_iterator it = time_a.rbegin(); it != time_a.rend(); ++it){
+        std::map<size_t, double>::const_iterator other = time_b.find(it->first);
+        if (other == time_b.end() || it->second >= other->second)
+          break;
+        crossover = it->first;
+      }
+
+      BenchRecord record;
+      record.set("device", device.features.device_name);
+      record.set("crossover", options.modes[a] + " faster than " + options.modes[b]);
+      record.set("from_elements", crossover);
+      record.set("found", crossover != 0);
+      report.add(record);
+
+      if (crossover)
+        std::cout << options.modes[a] << " beats " << options.modes[b] << " from " << crossover << " elements on.\n";
+    }
+  }
+}
@@ -0,0 +1,46 @@
+#ifndef __BENCHMARK_H__
+#define __BENCHMARK_H__
+
+#include "ClContext.h"
+#include "BenchOptions.h"
+#include "BenchReport.h"
+#include "BenchStats.h"
+#include "TransferStrategy.h"
+#include "ClKernelVariant.h"
+
+// mem_size is always in float4 elements, variant is the specialization the kernel was built with.
+// local_ws sizes the __local tile of the local family.
+void setTransferKernelArgs(cl_kernel kernel, TransferStrategy& strategy, size_t mem_size, size_t local_ws,
+                           const ClKernelVariant& variant = ClKernelVariant());
+
+// One iteration: strategy.beforeKernel, the kernel, strategy.transfer and clFinish.
+// The kernel arguments have to be set with setTransferKernelArgs before.
+// false if the kernel could not be enqueued or the queue did not finish, the timing is meaningless then.
+bool runTransferIteration(ClContext* cl, const ClDevice& device, cl_kernel kernel, TransferStrategy& strategy,
+                          size_t mem_size, size_t local_ws, IterationTiming& timing,
+                          const ClKernelVariant& variant = ClKernelVariant());
+
+// Runs warmup + timed iterations of the copy kernel on the first mem_size elements of the
+// strategy buffers and returns the measured result row.
+// If timeline is given, one row per timed iteration is added to it, stats receives the wall time statistics.
+BenchRecord runTransferBenchmark(ClContext* cl, const ClDevice& device, cl_kernel kernel, const BenchOptions& options,
+                                 TransferStrategy& strategy, size_t mem_size, size_t local_ws,
+                                 BenchReport* timeline = nullptr, SampleStats* stats = nullptr,
+                                 const ClKernelVariant& variant = ClKernelVariant());
+
+// Runs every transfer strategy for every size in options.sizes.
+void runSizeList(ClContext* cl, const ClDevice& device, cl_kernel kernel, const BenchOptions& options, BenchReport& report, BenchReport* timeline);
+
+// Builds every variant in options.variants from options.kernel_file, runs it for every strategy and size
+// and reports the fastest variant of each.
+void runVariants(ClContext* cl, const ClDevice& device, const BenchOptions& options, BenchReport& report, BenchReport* timeline);
+
+// Runs every transfer strategy and size on the configuration of options.tune_family picked by AutoTuner,
+// the tuning trials are added to report as well.
+void runTuned(ClContext* cl, const ClDevice& device, const BenchOptions& options, BenchReport& report, BenchReport* timeline);
+
+// Runs every transfer strategy over geometric element counts and power of two local sizes
+// and reports the size where each strategy starts beating the others.
+void runSweep(ClContext* cl, const ClDevice& device, cl_kernel kernel, const BenchOptions& options, BenchReport& report, BenchReport* timeline);
+
+#endif
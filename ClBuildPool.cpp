@@ -0,0 +1,48 @@
+#include "ClBuildPool.h"
+
+// STD
+#include <algorithm>
+
+// BOOST
+#include <boost/bind.hpp>
+
+ClBuildPool::ClBuildPool(unsigned int num_threads) : m_num_threads(num_threads), m_stop(false) {
+  if (m_num_threads == 0)
+    m_num_threads = std::max(1u, boost::thread::hardware_concurrency());
+  for (unsigned int t = 0; t < m_num_threads; t++)
+    m_threads.create_thread(boost::bind(&ClBuildPool::worker, this));
+}
+
+ClBuildPool::~ClBuildPool() {
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_cond.notify_all();
+  m_threads.join_all();
+}
+
+void ClBuildPool::post(const boost::function<void()>& job) {
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_jobs.push_back(job);
+  }
+  m_cond.notify_one();
+}
+
+void ClBuildPool::worker() {
+  for (;;){
+    boost::function<void()> job;
+    {
+      boost::unique_lock<boost::mutex> lock(m_mutex);
+      while (!m_stop && m_jobs.empty())
+        m_cond.wait(lock);
+      // queued jobs still run on shutdown, their futures may be waited on.
+      if (m_jobs.empty())
+        return;
+      job = m_jobs.front();
+      m_jobs.pop_front();
+    }
+    job();
+  }
+}
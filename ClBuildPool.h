@@ -0,0 +1,33 @@
+#ifndef __CL_BUILD_POOL_H__
+#define __CL_BUILD_POOL_H__
+
+// STD
+#include <deque>
+
+// BOOST
+#include <boost/thread.hpp>
+#include <boost/function.hpp>
+
+// Fixed set of threads working off a queue of jobs, used to compile programs concurrently.
+class ClBuildPool {
+public:
+  // 0 threads: one per hardware thread.
+  ClBuildPool(unsigned int num_threads = 0);
+  ~ClBuildPool();
+
+  void post(const boost::function<void()>& job);
+
+  unsigned int size() const { return m_num_threads; }
+
+private:
+  void worker();
+
+  unsigned int                          m_num_threads;
+  bool                                  m_stop;
+  std::deque< boost::function<void()> > m_jobs;
+  boost::mutex                          m_mutex;
+  boost::condition_variable             m_cond;
+  boost::thread_group                   m_threads;
+};
+
+#endif
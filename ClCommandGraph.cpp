@@ -0,0 +1,203 @@
+#include "ClCommandGraph.h"
+
+// STD
+#include <iostream>
+
+ClCommandGraphStats::ClCommandGraphStats() :
+  commands(0), events(0), waits(0), flushes(0) {
+}
+
+ClCommandGraph::ClCommandGraph(ClContext* cl, const std::vector<cl_command_queue>& queues) :
+  m_cl(cl), m_queues(queues), m_next_queue(0) {
+  if (m_queues.empty())
+    std::cerr << "Command graph: no command queues, nodes cannot be added\n";
+  for (size_t q = 0; q < m_queues.size(); q++){
+    cl_command_queue_properties properties = 0;
+    clGetCommandQueueInfo(m_queues[q], CL_QUEUE_PROPERTIES, sizeof(properties), &properties, nullptr);
+    m_out_of_order.push_back((properties & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE) != 0);
+  }
+}
+
+ClCommandGraph::~ClCommandGraph() {
+  releaseEvents();
+}
+
+int ClCommandGraph::addNode(Node& node, const std::vector<int>& deps, int queue) {
+  if (m_queues.empty())
+    return -1;
+  int id = static_cast<int>(m_nodes.size());
+  for (size_t d = 0; d < deps.size(); d++){
+    if (deps[d] < 0 || deps[d] >= id){
+      std::cerr << "Command graph: node " << id << " depends on " << deps[d] << ", not an earlier node\n";
+      return -1;
+    }
+  }
+
+  if (queue < 0 || queue >= static_cast<int>(m_queues.size())){
+    queue = m_next_queue;
+    m_next_queue = (m_next_queue + 1) % static_cast<int>(m_queues.size());
+  }
+  node.queue = queue;
+  node.deps = deps;
+  node.needs_event = false;
+  node.event = 0;
+  m_nodes.push_back(node);
+  return id;
+}
+
+int ClCommandGraph::addKernel(cl_kernel kernel, size_t offset, size_t global_ws, size_t local_ws, const std::vector<int>& deps, int queue) {
+  Node node;
+  node.type = KERNEL;
+  node.kernel = kernel;
+  node.offset = offset;
+  node.global_ws = global_ws;
+  node.local_ws = local_ws;
+  node.src = node.dst = 0;
+  node.dst_offset = node.bytes = 0;
+  node.host_src = nullptr;
+  node.host_dst = nullptr;
+  return addNode(node, deps, queue);
+}
+
+int ClCommandGraph::addWrite(cl_mem mem, size_t offset, size_t bytes, const void* ptr, const std::vector<int>& deps, int queue) {
+  Node node;
+  node.type = WRITE;
+  node.kernel = 0;
+  node.global_ws = node.local_ws = 0;
+  node.src = 0;
+  node.dst = mem;
+  node.offset = 0;
+  node.dst_offset = offset;
+  node.bytes = bytes;
+  node.host_src = ptr;
+  node.host_dst = nullptr;
+  return addNode(node, deps, queue);
+}
+
+int ClCommandGraph::addRead(cl_mem mem, size_t offset, size_t bytes, void* ptr, const std::vector<int>& deps, int queue) {
+  Node node;
+  node.type = READ;
+  node.kernel = 0;
+  node.global_ws = node.local_ws = 0;
+  node.src = mem;
+  node.dst = 0;
+  node.offset = offset;
+  node.dst_offset = 0;
+  node.bytes = bytes;
+  node.host_src = nullptr;
+  node.host_dst = ptr;
+  return addNode(node, deps, queue);
+}
+
+int ClCommandGraph::addCopy(cl_mem src, cl_mem dst, size_t src_offset, size_t dst_offset, size_t bytes, const std::vector<int>& deps, int queue) {
+  Node node;
+  node.type = COPY;
+  node.kernel = 0;
+  node.global_ws = node.local_ws = 0;
+  node.src = src;
+  node.dst = dst;
+  node.offset = src_offset;
+  node.dst_offset = dst_offset;
+  node.bytes = bytes;
+  node.host_src = nullptr;
+  node.host_dst = nullptr;
+  return addNode(node, deps, queue);
+}
+
+void ClCommandGraph::setArg(int node, cl_uint index, size_t size, const void* value) {
+  if (node < 0 || node >= static_cast<int>(m_nodes.size()))
+    return;
+  KernelArg arg;
+  arg.index = index;
+  arg.size = size;
+  if (value)
+    arg.value.assign(static_cast<const unsigned char*>(value), static_cast<const unsigned char*>(value) + size);
+  m_nodes[node].args.push_back(arg);
+}
+
+cl_int ClCommandGraph::enqueue(Node& node, const std::vector<cl_event>& wait_list) {
+  cl_command_queue queue = m_queues[node.queue];
+  cl_uint n_wait = static_cast<cl_uint>(wait_list.size());
+  const cl_event* wait = wait_list.empty() ? nullptr : wait_list.data();
+  cl_event* event = node.needs_event ? &node.event : nullptr;
+
+  switch (node.type){
+  case KERNEL: {
+    // the arguments are captured by the enqueue, so nodes can share one kernel.
+    for (size_t a = 0; a < node.args.size(); a++){
+      const KernelArg& arg = node.args[a];
+      cl_int error = clSetKernelArg(node.kernel, arg.index, arg.size, arg.value.empty() ? nullptr : &arg.value[0]);
+      if (error != CL_SUCCESS)
+        return error;
+    }
+    size_t* local = node.local_ws > 0 ? &node.local_ws : nullptr;
+    return clEnqueueNDRangeKernel(queue, node.kernel, 1, &node.offset, &node.global_ws, local, n_wait, wait, event);
+  }
+  case WRITE:
+    return clEnqueueWriteBuffer(queue, node.dst, CL_FALSE, node.dst_offset, node.bytes, node.host_src, n_wait, wait, event);
+  case READ:
+    return clEnqueueReadBuffer(queue, node.src, CL_FALSE, node.offset, node.bytes, node.host_dst, n_wait, wait, event);
+  case COPY:
+    return clEnqueueCopyBuffer(queue, node.src, node.dst, node.offset, node.dst_offset, node.bytes, n_wait, wait, event);
+  }
+  return CL_INVALID_OPERATION;
+}
+
+bool ClCommandGraph::submit() {
+  releaseEvents();
+
+  // a node returns an event only if one of its dependents is not ordered after it by the queue.
+  for (size_t n = 0; n < m_nodes.size(); n++){
+    const Node& node = m_nodes[n];
+    for (size_t d = 0; d < node.deps.size(); d++){
+      Node& dep = m_nodes[node.deps[d]];
+      if (dep.queue != node.queue || m_out_of_order[node.queue])
+        dep.needs_event = true;
+    }
+  }
+
+  std::vector<cl_event> wait_list;
+  for (size_t n = 0; n < m_nodes.size(); n++){
+    Node& node = m_nodes[n];
+    wait_list.clear();
+    for (size_t d = 0; d < node.deps.size(); d++){
+      const Node& dep = m_nodes[node.deps[d]];
+      if (dep.queue != node.queue || m_out_of_order[node.queue])
+        wait_list.push_back(dep.event);
+    }
+
+    cl_int error = enqueue(node, wait_list); m_cl->checkError(error);
+    if (error != CL_SUCCESS)
+      return false;
+    m_stats.commands++;
+    m_stats.waits += wait_list.size();
+    if (node.event)
+      m_stats.events++;
+  }
+
+  for (size_t q = 0; q < m_queues.size(); q++)
+    clFlush(m_queues[q]);
+  m_stats.flushes += m_queues.size();
+  return true;
+}
+
+void ClCommandGraph::finish() {
+  for (size_t q = 0; q < m_queues.size(); q++)
+    clFinish(m_queues[q]);
+  releaseEvents();
+}
+
+void ClCommandGraph::clear() {
+  releaseEvents();
+  m_nodes.clear();
+  m_next_queue = 0;
+}
+
+void ClCommandGraph::releaseEvents() {
+  for (size_t n = 0; n < m_nodes.size(); n++){
+    if (m_nodes[n].event)
+      clReleaseEvent(m_nodes[n].event);
+    m_nodes[n].event = 0;
+    m_nodes[n].needs_event = false;
+  }
+}
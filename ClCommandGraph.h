@@ -0,0 +1,98 @@
+#ifndef __CL_COMMAND_GRAPH_H__
+#define __CL_COMMAND_GRAPH_H__
+
+// STD
+#include <vector>
+
+#include "ClContext.h"
+
+struct ClCommandGraphStats {
+  size_t  commands;
+  size_t  events;         // commands that had to return an event
+  size_t  waits;          // event wait list entries
+  size_t  flushes;
+
+  ClCommandGraphStats();
+};
+
+// Batched submission of many small commands (kernels, reads, writes, copies) over one or more
+// command queues of a device. Dependencies are given as node ids and become event wait lists only
+// where the queue does not order the commands anyway: between queues and on out-of-order queues.
+// Commands are not flushed one by one, submit flushes every queue once.
+class ClCommandGraph {
+public:
+  // queues belong to device, the graph does not release them. Without queues every add returns -1.
+  ClCommandGraph(ClContext* cl, const std::vector<cl_command_queue>& queues);
+  ~ClCommandGraph();
+
+  // Nodes return their id, -1 if deps are not earlier nodes. queue -1 picks the queues round robin.
+  // Kernel arguments are captured per node with setArg, the kernel itself may be shared by nodes.
+  int addKernel(cl_kernel kernel, size_t offset, size_t global_ws, size_t local_ws,
+                const std::vector<int>& deps = std::vector<int>(), int queue = -1);
+  int addWrite(cl_mem mem, size_t offset, size_t bytes, const void* ptr,
+               const std::vector<int>& deps = std::vector<int>(), int queue = -1);
+  int addRead(cl_mem mem, size_t offset, size_t bytes, void* ptr,
+              const std::vector<int>& deps = std::vector<int>(), int queue = -1);
+  int addCopy(cl_mem src, cl_mem dst, size_t src_offset, size_t dst_offset, size_t bytes,
+              const std::vector<int>& deps = std::vector<int>(), int queue = -1);
+
+  // argument index of kernel node. value nullptr with a size is __local memory.
+  void setArg(int node, cl_uint index, size_t size, const void* value);
+  template <typename T>
+  void setArg(int node, cl_uint index, const T& value) { setArg(node, index, sizeof(T), &value); }
+
+  // Enqueues every node in order and flushes the queues. false on the first failing command.
+  bool submit();
+
+  // Waits for all queues and releases the events of the last submit. The graph can be submitted again.
+  void finish();
+
+  // removes all nodes
+  void clear();
+
+  size_t size() const { return m_nodes.size(); }
+  const ClCommandGraphStats& stats() const { return m_stats; }
+
+private:
+  enum NodeType { KERNEL, WRITE, READ, COPY };
+
+  struct KernelArg {
+    cl_uint                     index;
+    size_t                      size;
+    std::vector<unsigned char>  value;    // empty for __local memory
+  };
+
+  struct Node {
+    NodeType          type;
+    int               queue;
+    std::vector<int>  deps;
+    bool              needs_event;
+    cl_event          event;
+
+    cl_kernel         kernel;
+    size_t            offset;       // kernel: global offset, otherwise src offset in bytes
+    size_t            global_ws;
+    size_t            local_ws;
+    std::vector<KernelArg> args;
+
+    cl_mem            src;
+    cl_mem            dst;
+    size_t            dst_offset;
+    size_t            bytes;
+    const void*       host_src;
+    void*             host_dst;
+  };
+
+  int addNode(Node& node, const std::vector<int>& deps, int queue);
+  cl_int enqueue(Node& node, const std::vector<cl_event>& wait_list);
+  void releaseEvents();
+
+  ClContext*                    m_cl;
+  std::vector<cl_command_queue> m_queues;
+  std::vector<bool>             m_out_of_order;
+  std::vector<Node>             m_nodes;
+  int                           m_next_queue;
+  ClCommandGraphStats           m_stats;
+};
+
+#endif
@@ -10,26 +10,64 @@
 #include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+
+// BOOST
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
 
 // RPE
 #include "helper.h"
-
-#ifdef _WIN32
-  // Windows
-  #include <windows.h>
-  #include <wingdi.h>
-#elif _LINUX
-  #include <GL/glx.h>
-#endif
+#include "ClProgramCache.h"
+#include "ClBuildPool.h"
+#include "ClMemPool.h"
+#include "ClProfiling.h"
+#include "ClKernelVariant.h"
+#include "GlBackend.h"
 
 ClContext* ClContext::m_singleton = 0;
 ClContextDestructor ClContext::m_singleton_destructor;
+const char* const ClContext::default_build_options = "-cl-fast-relaxed-math -DINTEG_METHOD_EULER";
+
+// enumeration order of the device types in devices.
+static const cl_device_type device_type_order[] = { CL_DEVICE_TYPE_GPU, CL_DEVICE_TYPE_ACCELERATOR, CL_DEVICE_TYPE_CPU };
 
-#ifdef _WIN32
-void ClContext::init() {
-#elif _LINUX
-void ClContext::init(Display** display, Window* win, GLXContext* ctx) {
-#endif
+static int deviceTypeRank(cl_device_type type) {
+  for (int t = 0; t < 3; t++){
+    if (type & device_type_order[t])
+      return t;
+  }
+  return 3;
+}
+
+static const char* deviceTypeName(cl_device_type type) {
+  if (type & CL_DEVICE_TYPE_GPU)          return "GPU";
+  if (type & CL_DEVICE_TYPE_ACCELERATOR)  return "Accelerator";
+  if (type & CL_DEVICE_TYPE_CPU)          return "CPU";
+  return "Other";
+}
+
+// The CL devices that can share the GL context of properties and the one it renders on.
+// false if the platform does not have clGetGLContextInfoKHR.
+static bool queryGlContextDevices(cl_platform_id platform, const std::vector<cl_context_properties>& properties,
+                                  std::vector<cl_device_id>& gl_devices, cl_device_id& current_device) {
+  clGetGLContextInfoKHR_fn getGlContextInfo = (clGetGLContextInfoKHR_fn)clGetExtensionFunctionAddressForPlatform(platform, "clGetGLContextInfoKHR");
+  gl_devices.clear();
+  current_device = 0;
+  if (!getGlContextInfo)
+    return false;
+
+  size_t bytes = 0;
+  if (getGlContextInfo(properties.data(), CL_DEVICES_FOR_GL_CONTEXT_KHR, 0, nullptr, &bytes) == CL_SUCCESS && bytes > 0){
+    gl_devices.resize(bytes / sizeof(cl_device_id));
+    getGlContextInfo(properties.data(), CL_DEVICES_FOR_GL_CONTEXT_KHR, bytes, gl_devices.data(), nullptr);
+  }
+  if (getGlContextInfo(properties.data(), CL_CURRENT_DEVICE_FOR_GL_CONTEXT_KHR, sizeof(cl_device_id), &current_device, nullptr) != CL_SUCCESS)
+    current_device = 0;
+  return true;
+}
+
+void ClContext::init(const std::vector<GlBackend*>& gl_contexts, cl_command_queue_properties queue_properties, cl_device_type device_types) {
   cl_int error = CL_SUCCESS;
   cl_uint num_platforms;
   clGetPlatformIDs(0, nullptr, &num_platforms);
@@ -42,6 +80,9 @@ void ClContext::init(Display** display, Window* win, GLXContext* ctx) {
   platform_device.resize(num_platforms);
   platform_device_features.resize(num_platforms);
   devices.clear();
+  gpu_devices.clear();
+  cpu_devices.clear();
+  accelerator_devices.clear();
 
   error = clGetPlatformIDs(num_platforms, platform.data(), nullptr);
   checkError(error);
@@ -50,206 +91,567 @@ void ClContext::init(Display** display, Window* win, GLXContext* ctx) {
     << "=================================================================\n"
     << "Detecting the OPENCL Devices: \n"
     << "=================================================================\n";
-  int ctx_idx = 0;
+  std::vector<std::string> platform_names(num_platforms);
   for (cl_uint i = 0; i < num_platforms; i++){
      
-    std::string platform_name;
+    std::string& platform_name = platform_names[i];
     size_t platform_name_len;
     clGetPlatformInfo(platform[i], CL_PLATFORM_NAME, 0, nullptr, &platform_name_len);
     platform_name.resize(platform_name_len);
     clGetPlatformInfo(platform[i], CL_PLATFORM_NAME, platform_name_len, const_cast<char*>(platform_name.data()), nullptr);
     std::cout << "[" << i << "]\t" << platform_name << std::endl;
     
-    cl_uint num_devices;
-    error = clGetDeviceIDs(platform[i], CL_DEVICE_TYPE_GPU, 0, nullptr, &num_devices);
+    // a platform without devices of the requested types reports CL_DEVICE_NOT_FOUND.
+    cl_uint num_devices = 0;
+    error = clGetDeviceIDs(platform[i], device_types, 0, nullptr, &num_devices);
+    if (error != CL_SUCCESS)
+      num_devices = 0;
     platform_device[i].resize(num_devices);
     platform_device_features[i].resize(num_devices);
-    error = clGetDeviceIDs(platform[i], CL_DEVICE_TYPE_GPU, num_devices, platform_device[i].data(), nullptr);
+    if (num_devices > 0){
+      error = clGetDeviceIDs(platform[i], device_types, num_devices, platform_device[i].data(), nullptr);  checkError(error);
+    }
 
     for (cl_uint d = 0; d < num_devices; d++){
-
-        std::cout << d << std::endl;
-
-#ifdef _WIN32
-        // Context Properties for devices supporting opengl-opencl interoperatability.
-        cl_context_properties custom_props[] = {
-          // set platform
-          CL_CONTEXT_PLATFORM, (cl_context_properties)platform[i],
-
-          // set platform_device context
-          CL_WGL_HDC_KHR, (cl_context_properties)wglGetCurrentDC(),
-
-          // set current context
-          CL_GL_CONTEXT_KHR, (cl_context_properties)wglGetCurrentContext(),
-
-          0
-        };
-#elif _LINUX
-        // Context Properties for devices supporting opengl-opencl interoperatability.
-        cl_context_properties custom_props[] = {
-          // set platform
-          CL_CONTEXT_PLATFORM, (cl_context_properties)platform[i],
-
-          // set platform_device context
-          CL_GLX_DISPLAY_KHR, (cl_context_properties)glXGetCurrentDisplay(),
-
-          // set current context
-          CL_GL_CONTEXT_KHR, (cl_context_properties) glXGetCurrentContext(),
-
-          0
-        };
-#endif
-
       platform_device_features[i][d] = getDeviceFeatures(platform_device[i][d]);
-      ClDevice device;
-      std::cout << "\t\t[" << d << "]\t" << platform_device_features[i][d].device_name << std::endl;
-      std::cout << "\t\t\t" << "Max Const. Buf. Data = " << platform_device_features[i][d].max_constant_buffer_size << std::endl;
+      platform_device_features[i][d].platform_name = platform_name;
+      std::cout << "\t\t[" << d << "]\t" << platform_device_features[i][d].device_name
+                << " (" << deviceTypeName(platform_device_features[i][d].device_type) << ")" << std::endl;
+      const ClDeviceFeatures& features = platform_device_features[i][d];
+      std::cout << "\t\t\t" << features.device_version << ", driver " << features.driver_version << std::endl;
+      std::cout << "\t\t\t" << features.max_compute_units << " compute units, " << features.max_clock_frequency << " MHz, "
+                << "max work-group " << features.max_work_group_size << std::endl;
+      std::cout << "\t\t\t" << "Global Mem. = " << features.global_mem_size << ", Max Alloc. = " << features.max_mem_alloc_size
+                << ", Local Mem. = " << features.local_mem_size << (features.host_unified_memory ? ", unified with the host" : "") << std::endl;
+      std::cout << "\t\t\t" << "Max Const. Buf. Data = " << features.max_constant_buffer_size << std::endl;
       if (platform_device_features[i][d].has_cl_khr_gl_sharing)
         std::cout << "\t\t\tCLGL Interoperation extension is supported.\n";
       else
         std::cout << "\t\t\tWarning: CLGL Interoperation extension is not supported.\n";
+    }
 
-      device.id = platform_device[i][d];
-      device.features = platform_device_features[i][d];
-      device.features.platform_name = platform_name;
-      device.ctx_idx = ctx_idx++;
+    std::cout << "***************************************************************\n";
+  }
 
-      if (device.features.has_cl_khr_gl_sharing) {
-        device.ctx = clCreateContext(custom_props, 1, &device.id, nullptr, nullptr, &error);    checkError(error);
-        device.cmd_queue = clCreateCommandQueue(device.ctx, device.id, 0, &error);              checkError(error);
-      }
-      else {
-        device.ctx = clCreateContext(0, 1, &device.id, nullptr, nullptr, &error);               checkError(error);
-        device.cmd_queue = clCreateCommandQueue(device.ctx, device.id, 0, &error);              checkError(error);
+  // context properties of every GL context on every platform, for clCreateContext and clGetGLContextInfoKHR.
+  size_t n_gl = gl_contexts.size();
+  std::vector< std::vector< std::vector<cl_context_properties> > > gl_props(num_platforms, std::vector< std::vector<cl_context_properties> >(n_gl));
+  std::vector< std::vector< std::vector<cl_device_id> > > gl_devices(num_platforms, std::vector< std::vector<cl_device_id> >(n_gl));
+  std::vector< std::vector<cl_device_id> > gl_current(num_platforms, std::vector<cl_device_id>(n_gl, 0));
+  std::vector<bool> gl_queried(num_platforms, false);
+  for (cl_uint i = 0; i < num_platforms && n_gl > 0; i++){
+    for (size_t g = 0; g < n_gl; g++){
+      std::vector<cl_context_properties>& props = gl_props[i][g];
+      props.push_back(CL_CONTEXT_PLATFORM);
+      props.push_back((cl_context_properties)platform[i]);
+      gl_contexts[g]->appendClProperties(props);
+      props.push_back(0);
+      gl_queried[i] = queryGlContextDevices(platform[i], props, gl_devices[i][g], gl_current[i][g]);
+    }
+  }
+  std::vector<int> gl_users(n_gl, 0);
+
+  // devices of an unlisted type (e.g. CL_DEVICE_TYPE_CUSTOM) come last.
+  for (int rank = 0; rank <= 3; rank++){
+    for (cl_uint i = 0; i < num_platforms; i++){
+      for (size_t d = 0; d < platform_device[i].size(); d++){
+        if (deviceTypeRank(platform_device_features[i][d].device_type) != rank)
+          continue;
+
+        ClDevice device;
+        device.id = platform_device[i][d];
+        device.features = platform_device_features[i][d];
+        device.queue_properties = queue_properties;
+        device.gl = nullptr;
+        device.gl_current_device = false;
+
+        // the GL context this device shares
+        int bound = -1;
+        for (size_t g = 0; g < n_gl && device.features.has_cl_khr_gl_sharing; g++){
+          bool can_share = !gl_queried[i] || std::find(gl_devices[i][g].begin(), gl_devices[i][g].end(), device.id) != gl_devices[i][g].end();
+          if (!can_share)
+            continue;
+          if (gl_current[i][g] == device.id){
+            bound = static_cast<int>(g);
+            break;
+          }
+          if (bound < 0 || gl_users[g] < gl_users[bound])
+            bound = static_cast<int>(g);
+        }
+
+        if (bound >= 0) {
+          device.gl = gl_contexts[bound];
+          device.gl_current_device = gl_current[i][bound] == device.id;
+          gl_users[bound]++;
+          std::cout << device.features.device_name << ": " << device.gl->description() << " context"
+                    << (device.gl_current_device || !gl_queried[i] ? "" : ", rendered on another device") << std::endl;
+          device.ctx = clCreateContext(gl_props[i][bound].data(), 1, &device.id, nullptr, nullptr, &error);    checkError(error);
+          device.cmd_queue = clCreateCommandQueue(device.ctx, device.id, queue_properties, &error);              checkError(error);
+        }
+        else {
+          device.ctx = clCreateContext(0, 1, &device.id, nullptr, nullptr, &error);               checkError(error);
+          device.cmd_queue = clCreateCommandQueue(device.ctx, device.id, queue_properties, &error);              checkError(error);
+        }
+
+        // storing the device in the devices list
+        addDevice(device);
       }
-
-      // storing the device in the devices list
-      devices.push_back(device);
-
     }
-
-    std::cout << "***************************************************************\n";
   }
 
+  std::cout << "Devices: " << gpu_devices.size() << " GPU, " << accelerator_devices.size() << " accelerator, "
+            << cpu_devices.size() << " CPU\n";
+  for (size_t d = 0; d < devices.size(); d++)
+    std::cout << "\t[" << d << "]\t" << devices[d].features.device_name << " (" << deviceTypeName(devices[d].features.device_type) << ")\n";
+
   std::cout << "=================================================================\n"
             << "=================================================================\n";
 }
 
+void ClContext::addDevice(ClDevice& device) {
+  int idx = static_cast<int>(devices.size());
+  device.ctx_idx = idx;
+
+  if (device.features.device_type & CL_DEVICE_TYPE_GPU)
+    gpu_devices.push_back(idx);
+  else if (device.features.device_type & CL_DEVICE_TYPE_ACCELERATOR)
+    accelerator_devices.push_back(idx);
+  else if (device.features.device_type & CL_DEVICE_TYPE_CPU)
+    cpu_devices.push_back(idx);
+
+  devices.push_back(device);
+}
+
+bool ClContext::parseDeviceType(const std::string& str, cl_device_type& type) {
+  type = 0;
+  size_t beg = 0;
+  while (beg <= str.size()) {
+    size_t end = str.find(',', beg);
+    if (end == std::string::npos)
+      end = str.size();
+    std::string name = str.substr(beg, end - beg);
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+    if (name == "gpu")                type |= CL_DEVICE_TYPE_GPU;
+    else if (name == "cpu")           type |= CL_DEVICE_TYPE_CPU;
+    else if (name == "accelerator")   type |= CL_DEVICE_TYPE_ACCELERATOR;
+    else if (name == "all")           type |= CL_DEVICE_TYPE_ALL;
+    else
+      return false;
+    beg = end + 1;
+  }
+  return type != 0;
+}
+
+ClDeviceFeatures::ClDeviceFeatures() :
+  device_type(0),
+  global_mem_size(0),
+  local_mem_size(0),
+  max_mem_alloc_size(0),
+  max_constant_buffer_size(0),
+  global_mem_cache_size(0),
+  global_mem_cacheline_size(0),
+  mem_base_addr_align(0),
+  host_unified_memory(false),
+  max_compute_units(0),
+  max_work_group_size(0),
+  max_clock_frequency(0),
+  preferred_vector_width_char(0),
+  preferred_vector_width_short(0),
+  preferred_vector_width_int(0),
+  preferred_vector_width_float(0),
+  preferred_vector_width_double(0),
+  svm_capabilities(0),
+  queue_capabilities(0),
+  has_cl_khr_gl_sharing(false) {
+}
+
+std::string ClDeviceFeatures::profileKey() const {
+  return device_name + "|" + platform_name + "|" + driver_version;
+}
+
+// string device info without the terminating zero and surrounding blanks.
+static std::string deviceInfoString(cl_device_id device_id, cl_device_info param) {
+  size_t len = 0;
+  if (clGetDeviceInfo(device_id, param, 0, nullptr, &len) != CL_SUCCESS)
+    return std::string();
+  std::string str(len, '\0');
+  clGetDeviceInfo(device_id, param, len, const_cast<char*>(str.data()), nullptr);
+  str = str.c_str();
+
+  size_t beg = str.find_first_not_of(" \t");
+  size_t end = str.find_last_not_of(" \t");
+  return beg == std::string::npos ? std::string() : str.substr(beg, end - beg + 1);
+}
+
+// value device info, fallback if the device does not know param (e.g. newer than its OpenCL version).
+template <typename T>
+static T deviceInfo(cl_device_id device_id, cl_device_info param, T fallback) {
+  T value = fallback;
+  if (clGetDeviceInfo(device_id, param, sizeof(T), &value, nullptr) != CL_SUCCESS)
+    return fallback;
+  return value;
+}
+
 ClDeviceFeatures ClContext::getDeviceFeatures(cl_device_id device_id) {
   
   cl_int error = 0;
   ClDeviceFeatures features;
 
-  // Query for platform_device name
-  size_t device_name_len;
-  clGetDeviceInfo(device_id, CL_DEVICE_NAME, 0, nullptr, &device_name_len);
-  features.device_name.resize(device_name_len);
-  clGetDeviceInfo(device_id, CL_DEVICE_NAME, device_name_len, const_cast<char*>(features.device_name.data()), nullptr);
+  features.device_name    = deviceInfoString(device_id, CL_DEVICE_NAME);
+  features.vendor         = deviceInfoString(device_id, CL_DEVICE_VENDOR);
+  features.device_version = deviceInfoString(device_id, CL_DEVICE_VERSION);
+  features.driver_version = deviceInfoString(device_id, CL_DRIVER_VERSION);
 
-  // remove tabs from device names
-  std::remove(features.device_name.begin(), features.device_name.end(), ' ');
-
-  cl_ulong max_constant_buffer_size = 0;
-  error = clGetDeviceInfo(device_id, CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE, sizeof(cl_ulong), &max_constant_buffer_size, nullptr);
+  error = clGetDeviceInfo(device_id, CL_DEVICE_TYPE, sizeof(cl_device_type), &features.device_type, nullptr);
   checkError(error);
 
-  // Query for platform_device maximum constant buffer size
-  error = clGetDeviceInfo(device_id, CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE, sizeof(cl_ulong), &features.max_constant_buffer_size, nullptr);
-  checkError(error);
-  
+  features.global_mem_size            = deviceInfo<cl_ulong>(device_id, CL_DEVICE_GLOBAL_MEM_SIZE, 0);
+  features.local_mem_size             = deviceInfo<cl_ulong>(device_id, CL_DEVICE_LOCAL_MEM_SIZE, 0);
+  features.max_mem_alloc_size         = deviceInfo<cl_ulong>(device_id, CL_DEVICE_MAX_MEM_ALLOC_SIZE, 0);
+  features.max_constant_buffer_size   = deviceInfo<cl_ulong>(device_id, CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE, 0);
+  features.global_mem_cache_size      = deviceInfo<cl_ulong>(device_id, CL_DEVICE_GLOBAL_MEM_CACHE_SIZE, 0);
+  features.global_mem_cacheline_size  = deviceInfo<cl_uint>(device_id, CL_DEVICE_GLOBAL_MEM_CACHELINE_SIZE, 0);
+  features.mem_base_addr_align        = deviceInfo<cl_uint>(device_id, CL_DEVICE_MEM_BASE_ADDR_ALIGN, 0);
+  features.host_unified_memory        = deviceInfo<cl_bool>(device_id, CL_DEVICE_HOST_UNIFIED_MEMORY, CL_FALSE) != CL_FALSE;
+
+  features.max_compute_units          = deviceInfo<cl_uint>(device_id, CL_DEVICE_MAX_COMPUTE_UNITS, 0);
+  features.max_work_group_size        = deviceInfo<size_t>(device_id, CL_DEVICE_MAX_WORK_GROUP_SIZE, 0);
+  features.max_clock_frequency        = deviceInfo<cl_uint>(device_id, CL_DEVICE_MAX_CLOCK_FREQUENCY, 0);
+
+  features.preferred_vector_width_char   = deviceInfo<cl_uint>(device_id, CL_DEVICE_PREFERRED_VECTOR_WIDTH_CHAR, 0);
+  features.preferred_vector_width_short  = deviceInfo<cl_uint>(device_id, CL_DEVICE_PREFERRED_VECTOR_WIDTH_SHORT, 0);
+  features.preferred_vector_width_int    = deviceInfo<cl_uint>(device_id, CL_DEVICE_PREFERRED_VECTOR_WIDTH_INT, 0);
+  features.preferred_vector_width_float  = deviceInfo<cl_uint>(device_id, CL_DEVICE_PREFERRED_VECTOR_WIDTH_FLOAT, 0);
+  features.preferred_vector_width_double = deviceInfo<cl_uint>(device_id, CL_DEVICE_PREFERRED_VECTOR_WIDTH_DOUBLE, 0);
+
+  features.svm_capabilities           = deviceInfo<cl_bitfield>(device_id, CL_DEVICE_SVM_CAPABILITIES, 0);
+  features.queue_capabilities         = deviceInfo<cl_command_queue_properties>(device_id, CL_DEVICE_QUEUE_PROPERTIES, 0);
+
   // Query for all platform_device extensions
-  std::string device_extension;
-  size_t device_extension_len;
-  error = clGetDeviceInfo(device_id, CL_DEVICE_EXTENSIONS, 0, nullptr, &device_extension_len);                              
-  checkError(error);
-  device_extension.resize(device_extension_len);
-  error = clGetDeviceInfo(device_id, CL_DEVICE_EXTENSIONS, device_extension_len, (void*)device_extension.data(), nullptr);  
-  checkError(error);
+  std::istringstream extensions(deviceInfoString(device_id, CL_DEVICE_EXTENSIONS));
+  std::string extension;
+  while (extensions >> extension)
+    features.extensions.insert(extension);
   
   // check if the platform_device supports "cl_khr_gl_sharing" or not.
-  if (findString(device_extension, "cl_khr_gl_sharing")){
-    features.has_cl_khr_gl_sharing = true;
+  features.has_cl_khr_gl_sharing = features.hasExtension("cl_khr_gl_sharing");
+
+  return features;
+}
+
+int ClContext::findDevice(const std::string& selector) const {
+  if (selector.empty())
+    return -1;
+
+  // device index
+  if (selector.find_first_not_of("0123456789") == std::string::npos) {
+    size_t idx = static_cast<size_t>(atoi(selector.c_str()));
+    return idx < devices.size() ? static_cast<int>(idx) : -1;
   }
-  else {
-    features.has_cl_khr_gl_sharing = false;
+
+  std::string lower_selector = selector;
+  std::transform(lower_selector.begin(), lower_selector.end(), lower_selector.begin(), ::tolower);
+
+  // device type
+  if (lower_selector == "gpu")
+    return gpu_devices.empty() ? -1 : gpu_devices.front();
+  if (lower_selector == "cpu")
+    return cpu_devices.empty() ? -1 : cpu_devices.front();
+  if (lower_selector == "accelerator")
+    return accelerator_devices.empty() ? -1 : accelerator_devices.front();
+
+  for (size_t i = 0; i < devices.size(); i++) {
+    std::string lower_name = devices[i].features.device_name;
+    std::transform(lower_name.begin(), lower_name.end(), lower_name.begin(), ::tolower);
+    if (findString(lower_name, lower_selector))
+      return static_cast<int>(i);
   }
 
-  return features;
+  return -1;
 }
 
-cl_kernel ClContext::createKernel(const std::string& file_name, const std::string& kernel_name, const ClDevice& device) {
-  
+std::vector<int> ClContext::createSubDevices(int device_idx, cl_uint count) {
+  std::vector<int> indices;
+  cl_int error = 0;
+
+  // copy, devices grows below.
+  ClDevice parent = devices[device_idx];
+
+  cl_uint compute_units = 0, max_sub_devices = 0;
+  clGetDeviceInfo(parent.id, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(cl_uint), &compute_units, nullptr);
+  clGetDeviceInfo(parent.id, CL_DEVICE_PARTITION_MAX_SUB_DEVICES, sizeof(cl_uint), &max_sub_devices, nullptr);
+  if (count < 2 || max_sub_devices < count || compute_units < count){
+    std::cout << "Cannot partition " << parent.features.device_name << " into " << count << " sub-devices.\n";
+    return indices;
+  }
+
+  cl_device_partition_property props[] = {
+    CL_DEVICE_PARTITION_EQUALLY, static_cast<cl_device_partition_property>(compute_units / count),
+    0
+  };
+  cl_uint num_sub_devices = 0;
+  error = clCreateSubDevices(parent.id, props, 0, nullptr, &num_sub_devices);   checkError(error);
+  if (error != CL_SUCCESS)
+    return indices;
+  std::vector<cl_device_id> sub_ids(num_sub_devices);
+  error = clCreateSubDevices(parent.id, props, num_sub_devices, sub_ids.data(), nullptr);  checkError(error);
+  if (error != CL_SUCCESS)
+    return indices;
+  // a remainder of the compute units may form more sub-devices than asked for.
+  for (cl_uint d = count; d < num_sub_devices; d++)
+    clReleaseDevice(sub_ids[d]);
+
+  for (cl_uint d = 0; d < num_sub_devices && d < count; d++){
+    ClDevice device;
+    device.id = sub_ids[d];
+    device.features = getDeviceFeatures(device.id);
+    device.features.platform_name = parent.features.platform_name;
+    device.features.device_name = parent.features.device_name + " (sub-device " + std::to_string(static_cast<long long>(d)) + ")";
+    device.queue_properties = parent.queue_properties;
+    device.gl = nullptr;
+    device.gl_current_device = false;
+    device.ctx = clCreateContext(0, 1, &device.id, nullptr, nullptr, &error);                                checkError(error);
+    device.cmd_queue = clCreateCommandQueue(device.ctx, device.id, device.queue_properties, &error);          checkError(error);
+
+    std::cout << "\t\t[" << devices.size() << "]\t" << device.features.device_name << std::endl;
+    indices.push_back(static_cast<int>(devices.size()));
+    m_sub_devices.push_back(static_cast<int>(devices.size()));
+    addDevice(device);
+  }
+
+  return indices;
+}
+
+void ClContext::releaseSubDevices() {
+  for (size_t s = 0; s < m_sub_devices.size(); s++){
+    ClDevice& device = devices[m_sub_devices[s]];
+    if (device.cmd_queue)
+      clReleaseCommandQueue(device.cmd_queue);
+    if (device.ctx)
+      clReleaseContext(device.ctx);
+    clReleaseDevice(device.id);
+    device.cmd_queue = 0;
+    device.ctx = 0;
+  }
+  m_sub_devices.clear();
+}
+
+cl_program ClContext::buildProgram(const std::string& file_name, const std::string& options, const ClDevice& device) {
+
+  HostClock::time_point beg_time = HostClock::now();
+  ClBuildRecord record;
+  record.file_name = file_name;
+  record.device_name = device.features.device_name.c_str();
+  record.options = options;
+  record.error = CL_SUCCESS;
+
   cl_int error = 0;
+  cl_program prog = 0;
   std::ifstream prog_file(file_name.c_str());
   if (!prog_file){
     std::cout << "Cannot open " << file_name << std::endl;
+    record.error = CL_INVALID_VALUE;
+    record.log = "Cannot open " + file_name;
+  }
+  else {
+    std::string source(std::istreambuf_iterator<char>(prog_file), (std::istreambuf_iterator<char>()));
+
+    if (m_program_cache)
+      prog = m_program_cache->build(this, device, file_name, source, options, &record.log, &record.error);
+    else {
+      const char* source_cstr = source.c_str();
+      prog = clCreateProgramWithSource(device.ctx, 1, &source_cstr, NULL, &error);  checkError(error);
+      if (error == CL_SUCCESS){
+        error = compileProgram(prog, device, options);                              checkError(error);
+        record.log = getBuildLog(prog, device);
+      }
+      record.error = error;
+      if (error != CL_SUCCESS && prog){
+        clReleaseProgram(prog);
+        prog = 0;
+      }
+    }
   }
-  std::string source(std::istreambuf_iterator<char>(prog_file), (std::istreambuf_iterator<char>()));
-  const char* source_cstr = source.c_str();
-  cl_program prog = clCreateProgramWithSource(device.ctx, 1, &source_cstr, NULL, &error);  checkError(error);
-  error = clBuildProgram(prog, 0, NULL, "-cl-fast-relaxed-math -DINTEG_METHOD_EULER", NULL, NULL);                              checkError(error);
-//  if (error != CL_SUCCESS){
-//        std::ofstream build_log_file(file_name + "_build_" + device.features.device_name + ".log");
-//    std::string build_log;
-//   size_t build_log_len = 0;
-//
-//    clGetProgramBuildInfo(prog, device.id, CL_PROGRAM_BUILD_LOG, 0, nullptr, &build_log_len);
-//    build_log.resize(build_log_len);
-//    clGetProgramBuildInfo(prog, device.id, CL_PROGRAM_BUILD_LOG, build_log_len, const_cast<char*>(build_log.data()), nullptr);
-
-//   std::cout << "File name: " << file_name << ", Build Log:\n" << build_log << std::endl;
-
-//    if (build_log_file)
-//      build_log_file << build_log << std::endl;
+
+  record.success = prog != 0;
+  record.duration_ms = elapsedMs(beg_time, HostClock::now());
+  {
+    boost::lock_guard<boost::mutex> lock(m_build_records_mutex);
+    m_build_records.push_back(record);
+  }
+
+  if (!record.success){
+    std::string log_name = file_name + "_build_" + record.device_name + ".log";
+    for (size_t i = 0; i < log_name.size(); i++){
+      if (log_name[i] == ' ' || log_name[i] == '/' || log_name[i] == '\\' || log_name[i] == ':')
+        log_name[i] = '_';
+    }
+    std::ofstream build_log_file(log_name.c_str());
+    if (build_log_file)
+      build_log_file << "Options: " << options << "\n" << record.log << std::endl;
+
+    std::cerr << "Cannot build " << file_name << " for " << record.device_name << " (" << options << "), log in " << log_name << ":\n"
+              << record.log << std::endl;
 
     // STOP The application, if the kernel does not compile.
     // Due to crashes on nvidia gpu.
-//    if (error != CL_SUCCESS) exit(0);
+    if (m_fail_fast)
+      exit(1);
+  }
+
+  return prog;
+}
+
+std::string ClContext::getBuildLog(cl_program prog, const ClDevice& device) {
+  size_t build_log_len = 0;
+  if (!prog || clGetProgramBuildInfo(prog, device.id, CL_PROGRAM_BUILD_LOG, 0, nullptr, &build_log_len) != CL_SUCCESS)
+    return std::string();
+  std::string build_log(build_log_len, '\0');
+  clGetProgramBuildInfo(prog, device.id, CL_PROGRAM_BUILD_LOG, build_log_len, const_cast<char*>(build_log.data()), nullptr);
+  return build_log.c_str();
+}
+
+std::vector<ClBuildRecord> ClContext::getBuildRecords() const {
+  boost::lock_guard<boost::mutex> lock(m_build_records_mutex);
+  return m_build_records;
+}
+
+typedef boost::shared_ptr< boost::promise<void> > BuildDone;
+
+// user_data is a heap copy of the shared promise, owned and released by the callback.
+static void CL_CALLBACK buildNotify(cl_program, void* user_data) {
+  BuildDone* done = static_cast<BuildDone*>(user_data);
+  (*done)->set_value();
+  delete done;
+}
+
+cl_int ClContext::compileProgram(cl_program prog, const ClDevice& device, const std::string& options) {
+  BuildDone done(new boost::promise<void>());
+  boost::unique_future<void> done_future = done->get_future();
+
+  // with a callback clBuildProgram may return before the build is done. After an error the callback
+  // may still run on some runtimes, so it gets state of its own instead of this stack frame. If it
+  // never runs, its copy leaks.
+  cl_int error = clBuildProgram(prog, 1, &device.id, options.c_str(), buildNotify, new BuildDone(done));
+  if (error != CL_SUCCESS)
+    return error;
+  done_future.wait();
+
+  cl_build_status status = CL_BUILD_ERROR;
+  error = clGetProgramBuildInfo(prog, device.id, CL_PROGRAM_BUILD_STATUS, sizeof(cl_build_status), &status, nullptr);
+  if (error != CL_SUCCESS)
+    return error;
+  return status == CL_BUILD_SUCCESS ? CL_SUCCESS : CL_BUILD_PROGRAM_FAILURE;
+}
 
-  cl_kernel kernel = clCreateKernel(prog, kernel_name.c_str(), &error);                 checkError(error);
+const ClProgramEntry* ClContext::getProgram(const std::string& file_name, const std::string& options, const ClDevice& device) {
+  ClProgramKey key;
+  key.device = device.id;
+  key.file_name = file_name;
+  key.options = options;
+
+  {
+    boost::lock_guard<boost::mutex> lock(m_programs_mutex);
+    std::map<ClProgramKey, ClProgramEntry>::iterator it = m_programs.find(key);
+    if (it != m_programs.end())
+      return &it->second;
+  }
+
+  // built without holding the lock, so that different programs build in parallel.
+  cl_int error = 0;
+  ClProgramEntry entry;
+  entry.program = buildProgram(file_name, options, device);
+  if (!entry.program)
+    return nullptr;
+
+  // all kernels of the file at once.
+  cl_uint num_kernels = 0;
+  error = clCreateKernelsInProgram(entry.program, 0, nullptr, &num_kernels);                      checkError(error);
+  std::vector<cl_kernel> kernels(num_kernels);
+  if (num_kernels > 0){
+    error = clCreateKernelsInProgram(entry.program, num_kernels, kernels.data(), nullptr);        checkError(error);
+  }
+  for (cl_uint k = 0; k < num_kernels && error == CL_SUCCESS; k++){
+    size_t name_len = 0;
+    clGetKernelInfo(kernels[k], CL_KERNEL_FUNCTION_NAME, 0, nullptr, &name_len);
+    std::string name(name_len, '\0');
+    clGetKernelInfo(kernels[k], CL_KERNEL_FUNCTION_NAME, name_len, const_cast<char*>(name.data()), nullptr);
+    entry.kernels[name.c_str()] = kernels[k];
+  }
+
+  boost::lock_guard<boost::mutex> lock(m_programs_mutex);
+  std::map<ClProgramKey, ClProgramEntry>::iterator it = m_programs.find(key);
+  if (it != m_programs.end()){
+    // built concurrently by another request, keep the registered one.
+    for (std::map<std::string, cl_kernel>::iterator k = entry.kernels.begin(); k != entry.kernels.end(); ++k)
+      clReleaseKernel(k->second);
+    clReleaseProgram(entry.program);
+    return &it->second;
+  }
+  return &(m_programs[key] = entry);
+}
+
+static void getProgramJob(ClContext* cl, const std::string& file_name, const std::string& options, const ClDevice& device,
+                          boost::shared_ptr< boost::promise<const ClProgramEntry*> > result) {
+  result->set_value(cl->getProgram(file_name, options, device));
+}
+
+boost::shared_future<const ClProgramEntry*> ClContext::getProgramAsync(const std::string& file_name, const std::string& options,
+                                                                        const ClDevice& device) {
+  {
+    boost::lock_guard<boost::mutex> lock(m_programs_mutex);
+    if (!m_build_pool)
+      m_build_pool = new ClBuildPool();
+  }
+
+  boost::shared_ptr< boost::promise<const ClProgramEntry*> > result(new boost::promise<const ClProgramEntry*>());
+  boost::shared_future<const ClProgramEntry*> future(result->get_future());
+
+  // the job gets copies, devices may grow before it runs.
+  m_build_pool->post(boost::bind(getProgramJob, this, file_name, options, device, result));
+  return future;
+}
+
+cl_kernel ClContext::createKernel(const std::string& file_name, const std::string& kernel_name, const ClDevice& device) {
   
-  return kernel;
+  return createKernel(file_name, default_build_options, kernel_name, device);
 }
 
 cl_kernel ClContext::createKernel(const std::string& file_name, const std::string& definitions, const std::string& kernel_name, const ClDevice& device) {
 
-  std::cout << "========================================================\n";
-  std::cout << "Compiling: " << file_name << std::endl;
-  std::cout << "Device: " << device.features.device_name << std::endl;
-  std::cout << "========================================================\n";
+  const ClProgramEntry* entry = getProgram(file_name, definitions, device);
+  if (!entry)
+    return 0;
 
-  cl_int error = 0;
-  std::ifstream prog_file(file_name.c_str());
-  if (!prog_file){
-    std::cout << "Cannot open " << file_name << std::endl;
+  std::map<std::string, cl_kernel>::const_iterator it = entry->kernels.find(kernel_name);
+  if (it == entry->kernels.end()){
+    std::cout << "Cannot find kernel " << kernel_name << " in " << file_name << std::endl;
+    return 0;
   }
-  std::string source(std::istreambuf_iterator<char>(prog_file), (std::istreambuf_iterator<char>()));
-  const char* source_cstr = source.c_str();
-  cl_program prog = clCreateProgramWithSource(device.ctx, 1, &source_cstr, NULL, &error);  checkError(error);
-  error = clBuildProgram(prog, 0, NULL, definitions.data(), NULL, NULL);                            checkError(error);
-  cl_kernel kernel = clCreateKernel(prog, kernel_name.c_str(), &error);                             checkError(error);
-  //if (error != CL_SUCCESS){
-  //  std::ofstream build_log_file(file_name + "_build_" + device.features.device_name + ".log");
-  //  std::string build_log;
-  //  size_t build_log_len = 0;
-
-  //  clGetProgramBuildInfo(prog, device.id, CL_PROGRAM_BUILD_LOG, 0, nullptr, &build_log_len);
-  //  build_log.resize(build_log_len);
-  //  clGetProgramBuildInfo(prog, device.id, CL_PROGRAM_BUILD_LOG, build_log_len, const_cast<char*>(build_log.data()), nullptr);
-
-  //  std::cout << "Build Log:\n" << build_log << std::endl;
-
-  //  if (build_log_file)
-  //    build_log_file << build_log << std::endl;
- // }
 
-    // STOP The application, if the kernel does not compile.
-    // Due to crashes on nvidia gpu.
-  //  if (error != CL_SUCCESS) exit(0);
+  clRetainKernel(it->second);
+  return it->second;
+}
 
-    std::cout << "========================================================\n\n\n";
+cl_kernel ClContext::createKernel(const std::string& file_name, const ClKernelVariant& variant, const std::string& kernel_name, const ClDevice& device) {
 
-  return kernel;
+  return createKernel(file_name, variant.buildOptions(), kernel_name, device);
+}
+
+void ClContext::releasePrograms() {
+  boost::lock_guard<boost::mutex> lock(m_programs_mutex);
+  for (std::map<ClProgramKey, ClProgramEntry>::iterator it = m_programs.begin(); it != m_programs.end(); ++it){
+    for (std::map<std::string, cl_kernel>::iterator k = it->second.kernels.begin(); k != it->second.kernels.end(); ++k)
+      clReleaseKernel(k->second);
+    clReleaseProgram(it->second.program);
+  }
+  m_programs.clear();
+}
+
+void ClContext::setProgramCache(const std::string& directory) {
+  delete m_program_cache;
+  m_program_cache = directory.empty() ? nullptr : new ClProgramCache(directory);
 }
 
 ClContext* ClContext::getSingletonPtr(){
@@ -260,11 +662,42 @@ ClContext* ClContext::getSingletonPtr(){
   return m_singleton;
 }
 
-ClContext::ClContext() {
+ClContext::ClContext() : m_program_cache(nullptr), m_build_pool(nullptr), m_fail_fast(false), m_mem_pool_arena_bytes(0) {
+}
+
+cl_command_queue ClContext::createCommandQueue(const ClDevice& device, cl_command_queue_properties properties) {
+  properties |= device.queue_properties;
+  // profiling is always supported, everything else has to be a capability of the device.
+  if ((properties & ~CL_QUEUE_PROFILING_ENABLE) & ~device.features.queue_capabilities)
+    return 0;
+  cl_int error;
+  cl_command_queue queue = clCreateCommandQueue(device.ctx, device.id, properties, &error); checkError(error);
+  return error == CL_SUCCESS ? queue : 0;
 }
 
 ClContext::~ClContext() {
+  delete m_build_pool;
+  releasePrograms();
+  releaseMemPools();
+  releaseSubDevices();
+  delete m_program_cache;
+}
+
+ClMemPool* ClContext::getMemPool(const ClDevice& device) {
+  if (m_mem_pool_arena_bytes == 0)
+    return nullptr;
+  boost::lock_guard<boost::mutex> lock(m_mem_pools_mutex);
+  ClMemPool*& pool = m_mem_pools[device.id];
+  if (!pool)
+    pool = new ClMemPool(this, device, m_mem_pool_arena_bytes);
+  return pool;
+}
 
+void ClContext::releaseMemPools() {
+  boost::lock_guard<boost::mutex> lock(m_mem_pools_mutex);
+  for (std::map<cl_device_id, ClMemPool*>::iterator it = m_mem_pools.begin(); it != m_mem_pools.end(); ++it)
+    delete it->second;
+  m_mem_pools.clear();
 }
 
 void ClContext::checkError(cl_int error) {
@@ -4,8 +4,14 @@
 // STD
 #include <vector>
 #include <string>
+#include <map>
+#include <set>
 #define nullptr 0
 
+// BOOST
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/future.hpp>
+
 // CL
 #define CL_USE_DEPRECATED_OPENCL_2_0_APIS
 #define CL_USE_DEPRECATED_OPENCL_1_2_APIS
@@ -13,26 +19,54 @@
 #include <CL/cl.h>
 #include <CL/cl_gl.h>
 
-#ifdef _LINUX
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <unistd.h>
-#include <X11/Xlib.h>
-#include <X11/Xutil.h>
-#include <GL/gl.h>
-#include <GL/glx.h>
-#endif 
-
 class ClContextDestructor;
-
-//#define SEPRATE_CPU_GPU
+class ClProgramCache;
+class ClBuildPool;
+class ClMemPool;
+class ClKernelVariant;
+class GlBackend;
 
 struct ClDeviceFeatures {
-  std::string device_name;
-  std::string platform_name;
-  cl_ulong    max_constant_buffer_size;
-  bool        has_cl_khr_gl_sharing;
+  std::string     device_name;
+  std::string     platform_name;
+  std::string     vendor;
+  std::string     device_version;       // "OpenCL <major>.<minor> ..."
+  std::string     driver_version;
+  cl_device_type  device_type;
+
+  // memory
+  cl_ulong        global_mem_size;
+  cl_ulong        local_mem_size;
+  cl_ulong        max_mem_alloc_size;
+  cl_ulong        max_constant_buffer_size;
+  cl_ulong        global_mem_cache_size;
+  cl_uint         global_mem_cacheline_size;
+  cl_uint         mem_base_addr_align;  // in bits
+  bool            host_unified_memory;
+
+  // execution
+  cl_uint         max_compute_units;
+  size_t          max_work_group_size;
+  cl_uint         max_clock_frequency;  // MHz
+
+  // preferred vector widths
+  cl_uint         preferred_vector_width_char;
+  cl_uint         preferred_vector_width_short;
+  cl_uint         preferred_vector_width_int;
+  cl_uint         preferred_vector_width_float;
+  cl_uint         preferred_vector_width_double;
+
+  cl_bitfield     svm_capabilities;     // CL_DEVICE_SVM_*, 0 before OpenCL 2.0
+  cl_command_queue_properties queue_capabilities;  // CL_DEVICE_QUEUE_PROPERTIES, e.g. out-of-order execution
+  std::set<std::string> extensions;
+  bool            has_cl_khr_gl_sharing;
+
+  ClDeviceFeatures();
+
+  bool hasExtension(const std::string& name) const { return extensions.count(name) != 0; }
+
+  // Identifies the device and driver: equal keys mean tuning results can be reused.
+  std::string profileKey() const;
 };
 
 struct ClDevice {
@@ -40,44 +74,162 @@ struct ClDevice {
   ClDeviceFeatures  features;
   cl_context        ctx;
   cl_command_queue  cmd_queue;
+  cl_command_queue_properties queue_properties;
   int               ctx_idx;
 
   int               active;
+
+  // GL context shared by ctx, nullptr without interop. Several devices may share one context.
+  const GlBackend*  gl;
+  bool              gl_current_device;  // gl renders on this device (CL_CURRENT_DEVICE_FOR_GL_CONTEXT_KHR)
+};
+
+// A built program and all of its kernels, owned by ClContext.
+struct ClProgramEntry {
+  cl_program                        program;
+  std::map<std::string, cl_kernel>  kernels;    // by function name
+};
+
+// Outcome of one program build, see ClContext::getBuildRecords.
+struct ClBuildRecord {
+  std::string file_name;
+  std::string device_name;
+  std::string options;      // effective build options
+  bool        success;
+  cl_int      error;
+  double      duration_ms;  // read, build (or cache load) and log query
+  std::string log;          // CL_PROGRAM_BUILD_LOG, also kept for successful builds (warnings)
+};
+
+// Programs are shared per device, source file and build options.
+struct ClProgramKey {
+  cl_device_id  device;
+  std::string   file_name;
+  std::string   options;
+
+  bool operator<(const ClProgramKey& other) const {
+    if (device != other.device)       return device < other.device;
+    if (file_name != other.file_name) return file_name < other.file_name;
+    return options < other.options;
+  }
 };
 
 class ClContext {
   friend class ClContextDestructor;
 public:
-#ifdef _WIN32
-  void init();
-#elif _LINUX
-  void init(Display** display, Window* win, GLXContext* ctx);
-#endif
+  // queue_properties are passed to every command queue, e.g. CL_QUEUE_PROFILING_ENABLE.
+  // device_types selects the enumerated devices. GPUs come first in devices, then accelerators,
+  // then CPUs, so device 0 is the first GPU whenever there is one.
+  // Every device with cl_khr_gl_sharing is bound to one of gl_contexts (empty for CL only runs):
+  // preferably the one rendering on it, else one its platform can share (CL_DEVICES_FOR_GL_CONTEXT_KHR)
+  // and no other device is bound to yet, else the least shared one. See ClDevice::gl.
+  void init(const std::vector<GlBackend*>& gl_contexts = std::vector<GlBackend*>(),
+            cl_command_queue_properties queue_properties = 0, cl_device_type device_types = CL_DEVICE_TYPE_ALL);
+  // build options of createKernel without definitions
+  static const char* const default_build_options;
+
+  // Kernels come from the program registry, a file is built once per device and options.
+  // The returned kernel is retained for the caller, release it with clReleaseKernel. Callers asking for the
+  // same kernel share one cl_kernel, so its arguments have to be set before every enqueue.
   cl_kernel createKernel(const std::string& file_name, const std::string& kernel_name, const ClDevice& device);
   cl_kernel createKernel(const std::string& file_name, const std::string& definitions, const std::string& kernel_name, const ClDevice& device);
+  // build options generated from variant, every variant is built once and kept in the registry.
+  cl_kernel createKernel(const std::string& file_name, const ClKernelVariant& variant, const std::string& kernel_name, const ClDevice& device);
+
+  // Returns the registry entry of file_name built with options for device, builds it on the first request.
+  // nullptr if the program does not build. Thread safe.
+  const ClProgramEntry* getProgram(const std::string& file_name, const std::string& options, const ClDevice& device);
+
+  // getProgram on the build thread pool. Requesting every (device, file) pair first and waiting
+  // afterwards bounds the startup time by the slowest build instead of the sum of all builds.
+  boost::shared_future<const ClProgramEntry*> getProgramAsync(const std::string& file_name, const std::string& options,
+                                                              const ClDevice& device);
+
+  // Every build since init, in completion order.
+  std::vector<ClBuildRecord> getBuildRecords() const;
+
+  // fail_fast: exit on the first program that does not build, after printing its log.
+  void setFailFast(bool fail_fast) { m_fail_fast = fail_fast; }
+
+  // CL_PROGRAM_BUILD_LOG of prog for device.
+  std::string getBuildLog(cl_program prog, const ClDevice& device);
+
+  // clBuildProgram for device with a pfn_notify callback, waits for the callback.
+  // Returns CL_BUILD_PROGRAM_FAILURE if the build status of device is not CL_BUILD_SUCCESS.
+  cl_int compileProgram(cl_program prog, const ClDevice& device, const std::string& options);
+
+  // releases every registered kernel and program.
+  void releasePrograms();
+
+  // programs are loaded from / stored to a binary cache in directory, empty builds from source every time.
+  void setProgramCache(const std::string& directory);
+  const ClProgramCache* getProgramCache() const { return m_program_cache; }
+
+  // device buffers are sub-allocated from per-device arenas of arena_bytes, 0 disables the pools.
+  void setMemPool(size_t arena_bytes) { m_mem_pool_arena_bytes = arena_bytes; }
+  // the pool of device, created on first use. nullptr if the pools are disabled.
+  ClMemPool* getMemPool(const ClDevice& device);
+  void releaseMemPools();
 
   static ClContext* getSingletonPtr();
   void checkError(cl_int error);
   ClDeviceFeatures getDeviceFeatures(cl_device_id dev_id);
 
+  // parses a comma separated list of gpu, cpu, accelerator and all into a device type mask.
+  static bool parseDeviceType(const std::string& str, cl_device_type& type);
+
+  // Returns the index in devices matching a device index, a device type (gpu, cpu, accelerator)
+  // or a case-insensitive part of the device name. Returns -1 if nothing matches.
+  int findDevice(const std::string& selector) const;
+
+  // An additional command queue on the context of device, with properties on top of device.queue_properties
+  // (e.g. CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE). The caller releases it. 0 if the device does not support properties.
+  cl_command_queue createCommandQueue(const ClDevice& device, cl_command_queue_properties properties);
+
+  // Partitions devices[device_idx] equally into count sub-devices (CL_DEVICE_PARTITION_EQUALLY),
+  // each with its own context and command queue, and appends them to devices.
+  // Returns the indices of the new entries, empty if the device cannot be partitioned.
+  std::vector<int> createSubDevices(int device_idx, cl_uint count);
+
   //std::vector<cl_context>                     ctx;
   std::vector<cl_platform_id>                 platform;
-#ifdef SEPRATE_CPU_GPU
-  std::vector<std::vector<cl_device_id>>      cpu_devices;
-  std::vector<std::vector<cl_command_queue>>  cpu_devices_queue;
-  std::vector<std::vector<cl_device_id>>      gpu_devices;
-  std::vector<std::vector<cl_command_queue>>  gpu_devices_queue;
-#else //  SEPRATE_CPU_GPU
   std::vector< std::vector<cl_device_id> >      platform_device;
   std::vector< std::vector<ClDeviceFeatures> >  platform_device_features;
 
   std::vector<ClDevice> devices;
-#endif // SEPRATE_CPU_GPU
+
+  // indices into devices by device type
+  std::vector<int>      gpu_devices;
+  std::vector<int>      cpu_devices;
+  std::vector<int>      accelerator_devices;
 
 private:
   ClContext();
   ~ClContext();
 
+  // appends device to devices and to the index list of its type.
+  void addDevice(ClDevice& device);
+
+  // releases the queues, contexts and ids of the sub-devices, after the programs and pools built on them.
+  void releaseSubDevices();
+
+  // reads file_name and builds it for device, through the program cache if there is one.
+  cl_program buildProgram(const std::string& file_name, const std::string& options, const ClDevice& device);
+
+  ClProgramCache*   m_program_cache;
+  ClBuildPool*      m_build_pool;       // created on the first asynchronous build
+  std::vector<int>  m_sub_devices;      // indices into devices created by createSubDevices
+  std::map<ClProgramKey, ClProgramEntry>  m_programs;
+  boost::mutex      m_programs_mutex;
+
+  std::vector<ClBuildRecord>  m_build_records;
+  mutable boost::mutex        m_build_records_mutex;
+  bool                        m_fail_fast;
+
+  size_t                                m_mem_pool_arena_bytes;
+  std::map<cl_device_id, ClMemPool*>    m_mem_pools;
+  boost::mutex                          m_mem_pools_mutex;
+
   static ClContext* m_singleton;
   static ClContextDestructor m_singleton_destructor;
 };
@@ -0,0 +1,171 @@
+#include "ClKernelVariant.h"
+
+// STD
+#include <sstream>
+#include <stdlib.h>
+
+static size_t scalarBytes(const std::string& scalar_type) {
+  if (scalar_type == "char" || scalar_type == "uchar")    return 1;
+  if (scalar_type == "short" || scalar_type == "ushort")  return 2;
+  if (scalar_type == "float" || scalar_type == "int" || scalar_type == "uint")  return 4;
+  return 0;
+}
+
+static bool isVectorWidth(int width) {
+  return width == 1 || width == 2 || width == 4 || width == 8 || width == 16;
+}
+
+static const char* families[][2] = {
+  { "copy",    "myKernel" },
+  { "stride",  "copyGridStride" },
+  { "vload",   "copyVload" },
+  { "local",   "copyLocal" },
+  { "compute", "copyCompute" }
+};
+static const size_t num_families = sizeof(families) / sizeof(families[0]);
+
+static const char* familyKernel(const std::string& family) {
+  for (size_t f = 0; f < num_families; f++){
+    if (family == families[f][0])
+      return families[f][1];
+  }
+  return nullptr;
+}
+
+ClKernelVariant::ClKernelVariant() :
+  m_family("copy"),
+  m_compute_iterations(64),
+  m_scalar_type("float"),
+  m_vector_width(4),
+  m_elements_per_item(1) {
+  m_math_flags.insert("-cl-fast-relaxed-math");
+}
+
+bool ClKernelVariant::parse(const std::string& str, ClKernelVariant& variant) {
+  size_t colon = str.find(':');
+  std::string family = colon == std::string::npos ? "copy" : str.substr(0, colon);
+  std::string spec = colon == std::string::npos ? str : str.substr(colon + 1);
+  if (!familyKernel(family))
+    return false;
+
+  size_t x = spec.find('x');
+  std::string type = spec.substr(0, x);
+  int elements_per_item = 1;
+  if (x != std::string::npos){
+    elements_per_item = atoi(spec.c_str() + x + 1);
+    if (elements_per_item <= 0)
+      return false;
+  }
+
+  size_t digits = type.find_first_of("0123456789");
+  std::string scalar_type = type.substr(0, digits);
+  int vector_width = digits == std::string::npos ? 1 : atoi(type.c_str() + digits);
+  if (scalarBytes(scalar_type) == 0 || !isVectorWidth(vector_width))
+    return false;
+  if (family == "compute" && scalar_type != "float")
+    return false;
+
+  variant.setFamily(family);
+  variant.setElementType(scalar_type, vector_width);
+  variant.setElementsPerItem(elements_per_item);
+  return true;
+}
+
+ClKernelVariant& ClKernelVariant::setFamily(const std::string& family) {
+  m_family = family;
+  return *this;
+}
+
+ClKernelVariant& ClKernelVariant::setComputeIterations(int iterations) {
+  m_compute_iterations = iterations;
+  return *this;
+}
+
+ClKernelVariant& ClKernelVariant::setElementType(const std::string& scalar_type, int vector_width) {
+  m_scalar_type = scalar_type;
+  m_vector_width = vector_width;
+  return *this;
+}
+
+ClKernelVariant& ClKernelVariant::setElementsPerItem(int elements_per_item) {
+  m_elements_per_item = elements_per_item;
+  return *this;
+}
+
+ClKernelVariant& ClKernelVariant::define(const std::string& key, const std::string& value) {
+  m_defines[key] = value;
+  return *this;
+}
+
+ClKernelVariant& ClKernelVariant::addMathFlag(const std::string& flag) {
+  m_math_flags.insert(flag);
+  return *this;
+}
+
+ClKernelVariant& ClKernelVariant::clearMathFlags() {
+  m_math_flags.clear();
+  return *this;
+}
+
+std::string ClKernelVariant::buildOptions() const {
+  std::ostringstream ss;
+  // sets and maps iterate in sorted order.
+  for (std::set<std::string>::const_iterator it = m_math_flags.begin(); it != m_math_flags.end(); ++it)
+    ss << *it << " ";
+  ss << "-DELEMENT_TYPE=" << elementType() << " -DSCALAR_TYPE=" << m_scalar_type << " -DVECTOR_WIDTH=" << m_vector_width
+     << " -DELEMENTS_PER_ITEM=" << m_elements_per_item;
+  // only the compute family depends on it, the other variants keep sharing their build.
+  if (m_family == "compute")
+    ss << " -DCOMPUTE_ITERATIONS=" << m_compute_iterations;
+  for (std::map<std::string, std::string>::const_iterator it = m_defines.begin(); it != m_defines.end(); ++it){
+    ss << " -D" << it->first;
+    if (!it->second.empty())
+      ss << "=" << it->second;
+  }
+  return ss.str();
+}
+
+std::string ClKernelVariant::elementType() const {
+  if (m_vector_width == 1)
+    return m_scalar_type;
+  std::ostringstream ss;
+  ss << m_scalar_type << m_vector_width;
+  return ss.str();
+}
+
+std::string ClKernelVariant::name() const {
+  std::ostringstream ss;
+  if (m_family != "copy")
+    ss << m_family << ":";
+  ss << elementType() << "x" << m_elements_per_item;
+  return ss.str();
+}
+
+std::string ClKernelVariant::kernelName() const {
+  const char* kernel = familyKernel(m_family);
+  return kernel ? kernel : "myKernel";
+}
+
+size_t ClKernelVariant::elementBytes() const {
+  return scalarBytes(m_scalar_type) * m_vector_width;
+}
+
+size_t ClKernelVariant::count(size_t bytes) const {
+  return bytes / elementBytes();
+}
+
+size_t ClKernelVariant::workItems(size_t bytes) const {
+  return (count(bytes) + m_elements_per_item - 1) / m_elements_per_item;
+}
+
+size_t ClKernelVariant::localMemBytes(size_t local_ws) const {
+  if (m_family != "local")
+    return 0;
+  return local_ws * m_elements_per_item * elementBytes();
+}
+
+double ClKernelVariant::flopsPerElement() const {
+  if (m_family != "compute")
+    return 0.0;
+  return 2.0 * m_compute_iterations * m_vector_width;
+}
@@ -0,0 +1,67 @@
+#ifndef __CL_KERNEL_VARIANT_H__
+#define __CL_KERNEL_VARIANT_H__
+
+// STD
+#include <map>
+#include <set>
+#include <string>
+
+// Compile-time specialization of a kernel source. The build options are generated from the
+// fields in a fixed order, so equal variants always produce equal options and share one entry
+// in the program registry and the binary cache of ClContext.
+// Kernels see ELEMENT_TYPE (e.g. float4), SCALAR_TYPE, VECTOR_WIDTH and ELEMENTS_PER_ITEM, see testKernel.cl.
+// The family selects the entry point of the copy kernel family:
+//   copy     myKernel        ELEMENTS_PER_ITEM elements per work-item, one global size apart
+//   stride   copyGridStride  grid-stride loop
+//   vload    copyVload       scalar pointers with vloadn/vstoren
+//   local    copyLocal       async_work_group_copy through local memory
+//   compute  copyCompute     COMPUTE_ITERATIONS multiply-adds per element, float only
+class ClKernelVariant {
+public:
+  // float4, one element per work-item, -cl-fast-relaxed-math
+  ClKernelVariant();
+
+  // "[family:]type[xN]", e.g. "float", "float16x4" or "local:float4x4": kernel family (default copy),
+  // element type and optionally elements per work-item.
+  static bool parse(const std::string& str, ClKernelVariant& variant);
+
+  ClKernelVariant& setFamily(const std::string& family);
+  ClKernelVariant& setComputeIterations(int iterations);
+
+  ClKernelVariant& setElementType(const std::string& scalar_type, int vector_width);
+  ClKernelVariant& setElementsPerItem(int elements_per_item);
+  ClKernelVariant& define(const std::string& key, const std::string& value = "");
+  ClKernelVariant& addMathFlag(const std::string& flag);     // e.g. -cl-mad-enable
+  ClKernelVariant& clearMathFlags();
+
+  std::string buildOptions() const;
+  std::string name() const;           // e.g. "float16x4" or "local:float4x4"
+  std::string elementType() const;    // e.g. "float16"
+  const std::string& family() const { return m_family; }
+  std::string kernelName() const;     // entry point in testKernel.cl
+
+  size_t elementBytes() const;
+  int    vectorWidth() const { return m_vector_width; }
+  int    elementsPerItem() const { return m_elements_per_item; }
+
+  // launch geometry over a buffer of bytes: number of elements and work-items.
+  size_t count(size_t bytes) const;
+  size_t workItems(size_t bytes) const;
+
+  // __local memory of the last kernel argument for a work-group of local_ws, 0 if the kernel has none.
+  size_t localMemBytes(size_t local_ws) const;
+
+  // arithmetic of the compute family, 0 for the pure copies.
+  double flopsPerElement() const;
+
+private:
+  std::string                         m_family;
+  int                                 m_compute_iterations;
+  std::string                         m_scalar_type;
+  int                                 m_vector_width;
+  int                                 m_elements_per_item;
+  std::set<std::string>               m_math_flags;
+  std::map<std::string, std::string>  m_defines;
+};
+
+#endif
@@ -0,0 +1,221 @@
+#include "ClMemPool.h"
+
+// STD
+#include <iostream>
+
+// BOOST
+#include <boost/thread/lock_guard.hpp>
+
+static size_t roundUp(size_t bytes, size_t alignment) {
+  return (bytes + alignment - 1) / alignment * alignment;
+}
+
+ClMemPoolStats::ClMemPoolStats() :
+  allocations(0), hits(0), sub_buffers_created(0), arenas_created(0), defragmentations(0),
+  bytes_in_use(0), peak_bytes_in_use(0), bytes_cached(0), bytes_reserved(0) {
+}
+
+ClMemPool::ClMemPool(ClContext* cl, const ClDevice& device, size_t arena_bytes) :
+  m_cl(cl), m_device(device), m_arena_bytes(arena_bytes) {
+  // CL_DEVICE_MEM_BASE_ADDR_ALIGN is in bits, sub-buffer origins have to be a multiple of it.
+  m_alignment = device.features.mem_base_addr_align / 8;
+  if (m_alignment < 256)
+    m_alignment = 256;
+}
+
+ClMemPool::~ClMemPool() {
+  // sub-buffers before their arenas
+  for (std::map<cl_mem, SubBuffer>::const_iterator it = m_sub_buffers.begin(); it != m_sub_buffers.end(); ++it)
+    clReleaseMemObject(it->first);
+  for (size_t a = 0; a < m_arenas.size(); a++)
+    clReleaseMemObject(m_arenas[a].buffer);
+}
+
+size_t ClMemPool::sizeClass(size_t bytes) const {
+  size_t power = m_alignment;
+  while (power * 2 <= bytes)
+    power *= 2;
+  // quarter steps between two powers of two waste at most 25%.
+  size_t step = power / 4 < m_alignment ? m_alignment : power / 4;
+  return roundUp(bytes, step);
+}
+
+void ClMemPool::freeRange(Arena& arena, size_t offset, size_t bytes) {
+  std::map<size_t, size_t>::iterator next = arena.free_ranges.lower_bound(offset);
+  if (next != arena.free_ranges.begin()){
+    std::map<size_t, size_t>::iterator prev = next;
+    --prev;
+    if (prev->first + prev->second == offset){
+      offset = prev->first;
+      bytes += prev->second;
+      arena.free_ranges.erase(prev);
+    }
+  }
+  if (next != arena.free_ranges.end() && offset + bytes == next->first){
+    bytes += next->second;
+    arena.free_ranges.erase(next);
+  }
+  arena.free_ranges[offset] = bytes;
+}
+
+cl_mem ClMemPool::carve(size_t bytes) {
+  for (size_t a = 0; a < m_arenas.size(); a++){
+    Arena& arena = m_arenas[a];
+    // size classes are multiples of the alignment, so every range starts aligned.
+    for (std::map<size_t, size_t>::iterator range = arena.free_ranges.begin(); range != arena.free_ranges.end(); ++range){
+      if (range->second < bytes)
+        continue;
+
+      cl_int error;
+      cl_buffer_region region = { range->first, bytes };
+      cl_mem mem = clCreateSubBuffer(arena.buffer, 0, CL_BUFFER_CREATE_TYPE_REGION, &region, &error); m_cl->checkError(error);
+      if (error != CL_SUCCESS)
+        return 0;
+
+      SubBuffer sub_buffer = { a, range->first, bytes };
+      m_sub_buffers[mem] = sub_buffer;
+      if (range->second > bytes)
+        arena.free_ranges[range->first + bytes] = range->second - bytes;
+      arena.free_ranges.erase(range);
+      m_stats.sub_buffers_created++;
+      return mem;
+    }
+  }
+  return 0;
+}
+
+bool ClMemPool::addArena(size_t min_bytes) {
+  size_t bytes = min_bytes > m_arena_bytes ? min_bytes : m_arena_bytes;
+  if (bytes > m_device.features.max_mem_alloc_size)
+    bytes = static_cast<size_t>(m_device.features.max_mem_alloc_size);
+  if (bytes < min_bytes)
+    return false;
+
+  cl_int error;
+  Arena arena;
+  arena.buffer = clCreateBuffer(m_device.ctx, CL_MEM_READ_WRITE, bytes, nullptr, &error); m_cl->checkError(error);
+  if (error != CL_SUCCESS)
+    return false;
+  arena.bytes = bytes;
+  arena.free_ranges[0] = bytes;
+  m_arenas.push_back(arena);
+  m_stats.arenas_created++;
+  m_stats.bytes_reserved += bytes;
+  return true;
+}
+
+void ClMemPool::releaseBins() {
+  for (std::map<size_t, std::vector<cl_mem> >::iterator bin = m_bins.begin(); bin != m_bins.end(); ++bin){
+    for (size_t i = 0; i < bin->second.size(); i++){
+      std::map<cl_mem, SubBuffer>::iterator it = m_sub_buffers.find(bin->second[i]);
+      freeRange(m_arenas[it->second.arena], it->second.offset, it->second.bytes);
+      clReleaseMemObject(it->first);
+      m_sub_buffers.erase(it);
+    }
+  }
+  m_bins.clear();
+  m_stats.bytes_cached = 0;
+}
+
+cl_mem ClMemPool::allocate(size_t bytes) {
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  size_t size_class = sizeClass(bytes);
+  m_stats.allocations++;
+
+  cl_mem mem = 0;
+  std::vector<cl_mem>& bin = m_bins[size_class];
+  if (!bin.empty()){
+    mem = bin.back();
+    bin.pop_back();
+    m_stats.hits++;
+    m_stats.bytes_cached -= size_class;
+  }
+  else {
+    mem = carve(size_class);
+    if (!mem && m_stats.bytes_cached > 0){
+      releaseBins();
+      mem = carve(size_class);
+    }
+    if (!mem && addArena(size_class))
+      mem = carve(size_class);
+    if (!mem){
+      std::cerr << "Device memory pool: no room for " << bytes << " bytes on " << m_device.features.device_name << std::endl;
+      return 0;
+    }
+  }
+
+  m_stats.bytes_in_use += size_class;
+  if (m_stats.bytes_in_use > m_stats.peak_bytes_in_use)
+    m_stats.peak_bytes_in_use = m_stats.bytes_in_use;
+  return mem;
+}
+
+bool ClMemPool::release(cl_mem mem) {
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  std::map<cl_mem, SubBuffer>::const_iterator it = m_sub_buffers.find(mem);
+  if (it == m_sub_buffers.end())
+    return false;
+
+  m_bins[it->second.bytes].push_back(mem);
+  m_stats.bytes_in_use -= it->second.bytes;
+  m_stats.bytes_cached += it->second.bytes;
+  return true;
+}
+
+bool ClMemPool::defragment() {
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  if (m_stats.bytes_in_use > 0)
+    return false;
+
+  releaseBins();
+
+  // every arena is one free range now, the largest one stays for the next run.
+  size_t largest = 0;
+  for (size_t a = 1; a < m_arenas.size(); a++){
+    if (m_arenas[a].bytes > m_arenas[largest].bytes)
+      largest = a;
+  }
+  for (size_t a = 0; a < m_arenas.size(); a++){
+    if (a != largest){
+      clReleaseMemObject(m_arenas[a].buffer);
+      m_stats.bytes_reserved -= m_arenas[a].bytes;
+    }
+  }
+  if (m_arenas.size() > 1){
+    Arena kept = m_arenas[largest];
+    m_arenas.assign(1, kept);
+  }
+  m_stats.defragmentations++;
+  return true;
+}
+
+ClMemPoolStats ClMemPool::stats() const {
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  return m_stats;
+}
+
+BenchRecord ClMemPool::toRecord() const {
+  ClMemPoolStats pool_stats = stats();
+  BenchRecord record;
+  record.set("device_mem_pool", true);
+  record.set("device", m_device.features.device_name);
+  record.set("alignment", m_alignment);
+  record.set("allocations", pool_stats.allocations);
+  record.set("hits", pool_stats.hits);
+  record.set("sub_buffers_created", pool_stats.sub_buffers_created);
+  record.set("arenas_created", pool_stats.arenas_created);
+  record.set("defragmentations", pool_stats.defragmentations);
+  record.set("bytes_in_use", pool_stats.bytes_in_use);
+  record.set("peak_bytes_in_use", pool_stats.peak_bytes_in_use);
+  record.set("bytes_cached", pool_stats.bytes_cached);
+  record.set("bytes_reserved", pool_stats.bytes_reserved);
+  return record;
+}
+
+void ClMemPool::printReport() const {
+  ClMemPoolStats pool_stats = stats();
+  std::cout << "Device memory pool (" << m_device.features.device_name << "): " << pool_stats.allocations << " allocations, "
+            << pool_stats.hits << " hits, " << pool_stats.sub_buffers_created << " sub-buffers, " << pool_stats.arenas_created
+            << " arenas, " << pool_stats.bytes_reserved / (1024 * 1024) << " MiB reserved, peak "
+            << pool_stats.peak_bytes_in_use / (1024 * 1024) << " MiB in use\n";
+}
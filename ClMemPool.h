@@ -0,0 +1,82 @@
+#ifndef __CL_MEM_POOL_H__
+#define __CL_MEM_POOL_H__
+
+// STD
+#include <map>
+#include <vector>
+
+// BOOST
+#include <boost/thread/mutex.hpp>
+
+#include "ClContext.h"
+#include "BenchReport.h"
+
+struct ClMemPoolStats {
+  size_t  allocations;
+  size_t  hits;                 // served from a size class bin, no driver call
+  size_t  sub_buffers_created;  // clCreateSubBuffer
+  size_t  arenas_created;       // clCreateBuffer
+  size_t  defragmentations;
+  size_t  bytes_in_use;
+  size_t  peak_bytes_in_use;
+  size_t  bytes_cached;         // released sub-buffers waiting in the bins
+  size_t  bytes_reserved;       // all arenas
+
+  ClMemPoolStats();
+};
+
+// Sub-allocator of one device: sub-buffers (clCreateSubBuffer) carved out of large CL_MEM_READ_WRITE
+// arenas at multiples of CL_DEVICE_MEM_BASE_ADDR_ALIGN. Sizes are rounded up to size classes
+// (quarter steps between powers of two) and a released sub-buffer waits in the bin of its class
+// for the next allocation of that class, so a warm pool allocates without calling the driver.
+// When the arenas are exhausted the bins are returned to the arenas first, defragment does the
+// same when nothing is in use and also releases the arenas that became empty.
+class ClMemPool {
+public:
+  ClMemPool(ClContext* cl, const ClDevice& device, size_t arena_bytes);
+  ~ClMemPool();
+
+  // 0 if the device has no room left.
+  cl_mem allocate(size_t bytes);
+
+  // false if mem is not a sub-buffer of this pool.
+  bool release(cl_mem mem);
+
+  // Only when idle: returns the bins to the arenas, coalesces them and releases all but the largest arena.
+  bool defragment();
+
+  ClMemPoolStats stats() const;
+  BenchRecord toRecord() const;
+  void printReport() const;
+
+private:
+  struct Arena {
+    cl_mem                    buffer;
+    size_t                    bytes;
+    std::map<size_t, size_t>  free_ranges;    // offset -> bytes
+  };
+
+  struct SubBuffer {
+    size_t  arena;
+    size_t  offset;
+    size_t  bytes;
+  };
+
+  size_t sizeClass(size_t bytes) const;
+  cl_mem carve(size_t bytes);
+  bool addArena(size_t min_bytes);
+  void freeRange(Arena& arena, size_t offset, size_t bytes);
+  void releaseBins();
+
+  ClContext*                            m_cl;
+  ClDevice                              m_device;     // a copy, devices may grow
+  size_t                                m_arena_bytes;
+  size_t                                m_alignment;    // bytes
+  std::vector<Arena>                    m_arenas;
+  std::map<cl_mem, SubBuffer>           m_sub_buffers;  // in use and cached
+  std::map<size_t, std::vector<cl_mem> > m_bins;        // size class -> released sub-buffers
+  ClMemPoolStats                        m_stats;
+  mutable boost::mutex                  m_mutex;
+};
+
+#endif
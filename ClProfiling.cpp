@@ -0,0 +1,74 @@
+#include "ClProfiling.h"
+
+double elapsedMs(const HostClock::time_point& beg, const HostClock::time_point& end) {
+  return std::chrono::duration<double, std::milli>(end - beg).count();
+}
+
+ClEventTiming::ClEventTiming() :
+  queued(0), submit(0), start(0), end(0), valid(false) {
+}
+
+double ClEventTiming::durationMs() const {
+  return valid ? (end - start) * 1.0e-6 : 0.0;
+}
+
+double ClEventTiming::latencyMs() const {
+  return valid ? (start - queued) * 1.0e-6 : 0.0;
+}
+
+ClEventTiming getEventTiming(cl_event event) {
+  ClEventTiming timing;
+  if (!event)
+    return timing;
+
+  cl_int error = CL_SUCCESS;
+  error |= clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_QUEUED, sizeof(cl_ulong), &timing.queued, nullptr);
+  error |= clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_SUBMIT, sizeof(cl_ulong), &timing.submit, nullptr);
+  error |= clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START,  sizeof(cl_ulong), &timing.start,  nullptr);
+  error |= clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END,    sizeof(cl_ulong), &timing.end,    nullptr);
+  timing.valid = (error == CL_SUCCESS);
+
+  return timing;
+}
+
+ClEventTiming takeEventTiming(cl_event& event) {
+  ClEventTiming timing = getEventTiming(event);
+  if (event) {
+    clReleaseEvent(event);
+    event = 0;
+  }
+  return timing;
+}
+
+IterationTiming::IterationTiming() :
+  gl_finish_ms(0.0), upload_ms(0.0), wall_ms(0.0) {
+}
+
+static void setStage(BenchRecord& record, const std::string& stage, const ClEventTiming& timing, cl_ulong origin) {
+  if (!timing.valid)
+    return;
+  record.set(stage + "_queued_us", (timing.queued - origin) * 1.0e-3);
+  record.set(stage + "_submit_us", (timing.submit - origin) * 1.0e-3);
+  record.set(stage + "_start_us",  (timing.start  - origin) * 1.0e-3);
+  record.set(stage + "_end_us",    (timing.end    - origin) * 1.0e-3);
+}
+
+BenchRecord IterationTiming::toRecord(int iteration) const {
+  cl_ulong origin = 0;
+  const ClEventTiming* stages[] = { &acquire, &kernel, &read, &release };
+  for (size_t i = 0; i < sizeof(stages) / sizeof(stages[0]); i++) {
+    if (stages[i]->valid && (origin == 0 || stages[i]->queued < origin))
+      origin = stages[i]->queued;
+  }
+
+  BenchRecord record;
+  record.set("iteration", iteration);
+  record.set("wall_ms", wall_ms);
+  record.set("gl_finish_ms", gl_finish_ms);
+  record.set("upload_ms", upload_ms);
+  setStage(record, "acquire", acquire, origin);
+  setStage(record, "kernel", kernel, origin);
+  setStage(record, "read", read, origin);
+  setStage(record, "release", release, origin);
+  return record;
+}
@@ -0,0 +1,54 @@
+#ifndef __CL_PROFILING_H__
+#define __CL_PROFILING_H__
+
+// STD
+#include <chrono>
+#include <string>
+
+// CL
+#include "ClContext.h"
+#include "BenchReport.h"
+
+// Host side stages are measured in wall time, never in process cpu time.
+typedef std::chrono::steady_clock HostClock;
+
+double elapsedMs(const HostClock::time_point& beg, const HostClock::time_point& end);
+
+// CL_PROFILING_COMMAND_* timestamps of one command in nanoseconds of the device clock.
+struct ClEventTiming {
+  cl_ulong  queued;
+  cl_ulong  submit;
+  cl_ulong  start;
+  cl_ulong  end;
+  bool      valid;
+
+  ClEventTiming();
+
+  double durationMs() const;  // start -> end
+  double latencyMs() const;   // queued -> start
+};
+
+// The queue of the event must have been created with CL_QUEUE_PROFILING_ENABLE,
+// otherwise the returned timing is not valid.
+ClEventTiming getEventTiming(cl_event event);
+
+// Releases the event (if any) after reading its timestamps.
+ClEventTiming takeEventTiming(cl_event& event);
+
+// Breakdown of one benchmark iteration.
+struct IterationTiming {
+  ClEventTiming acquire;      // clEnqueueAcquireGLObjects
+  ClEventTiming kernel;       // clEnqueueNDRangeKernel
+  ClEventTiming read;         // clEnqueueReadBuffer / map / copy of the output
+  ClEventTiming release;      // clEnqueueReleaseGLObjects / unmap
+  double        gl_finish_ms; // host: glFinish / GL fence before the acquire
+  double        upload_ms;    // host: glBufferSubData / GL map and unmap
+  double        wall_ms;      // host: whole iteration
+
+  IterationTiming();
+
+  // One timeline row, device timestamps are in microseconds relative to the first queued command.
+  BenchRecord toRecord(int iteration) const;
+};
+
+#endif
@@ -0,0 +1,240 @@
+#include "ClProgramCache.h"
+#include "ClProfiling.h"
+
+// STD
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdio.h>
+
+// BOOST
+#include <boost/thread/thread.hpp>
+
+#ifdef _WIN32
+  #include <direct.h>
+  #include <process.h>
+#else
+  #include <sys/stat.h>
+  #include <sys/types.h>
+  #include <unistd.h>
+#endif
+
+static const char* cache_magic = "CLPROGRAMCACHE 1";
+
+// 64 bit FNV-1a
+static unsigned long long fnv1a(const std::string& str) {
+  unsigned long long hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < str.size(); i++){
+    hash ^= static_cast<unsigned char>(str[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+static std::string toHex(unsigned long long value) {
+  std::ostringstream ss;
+  ss << std::hex << std::setw(16) << std::setfill('0') << value;
+  return ss.str();
+}
+
+// strings queried from CL keep their terminating zero.
+static std::string deviceInfoString(cl_device_id device, cl_device_info param) {
+  size_t len = 0;
+  clGetDeviceInfo(device, param, 0, nullptr, &len);
+  std::string str(len, '\0');
+  clGetDeviceInfo(device, param, len, const_cast<char*>(str.data()), nullptr);
+  return str.c_str();
+}
+
+static std::string platformInfoString(cl_platform_id platform, cl_platform_info param) {
+  size_t len = 0;
+  clGetPlatformInfo(platform, param, 0, nullptr, &len);
+  std::string str(len, '\0');
+  clGetPlatformInfo(platform, param, len, const_cast<char*>(str.data()), nullptr);
+  return str.c_str();
+}
+
+ClProgramCache::ClProgramCache(const std::string& directory) : m_directory(directory) {
+#ifdef _WIN32
+  _mkdir(m_directory.c_str());
+#else
+  mkdir(m_directory.c_str(), 0755);
+#endif
+}
+
+ClProgramCache::Key ClProgramCache::makeKey(const ClDevice& device, const std::string& source, const std::string& options) const {
+  cl_platform_id platform = 0;
+  clGetDeviceInfo(device.id, CL_DEVICE_PLATFORM, sizeof(cl_platform_id), &platform, nullptr);
+
+  Key key;
+  key.source_hash     = toHex(fnv1a(source));
+  key.options         = options;
+  key.device_name     = device.features.device_name.c_str();
+  key.driver_version  = deviceInfoString(device.id, CL_DRIVER_VERSION);
+  key.platform        = platformInfoString(platform, CL_PLATFORM_NAME) + " " + platformInfoString(platform, CL_PLATFORM_VERSION);
+  return key;
+}
+
+std::string ClProgramCache::path(const Key& key) const {
+  std::string all = key.source_hash + "\n" + key.options + "\n" + key.device_name + "\n" + key.driver_version + "\n" + key.platform;
+  return m_directory + "/" + toHex(fnv1a(all)) + ".bin";
+}
+
+cl_program ClProgramCache::load(ClContext* cl, const ClDevice& device, const Key& key) {
+  std::string file_path = path(key);
+  std::ifstream file(file_path.c_str(), std::ios::binary);
+  if (!file)
+    return 0;
+
+  // the file name is only a hash, the stored key has to match as a whole.
+  std::string magic, source_hash, options, device_name, driver_version, platform, size_str;
+  std::getline(file, magic);
+  std::getline(file, source_hash);
+  std::getline(file, options);
+  std::getline(file, device_name);
+  std::getline(file, driver_version);
+  std::getline(file, platform);
+  std::getline(file, size_str);
+
+  std::vector<unsigned char> binary;
+  bool valid = file && magic == cache_magic && source_hash == key.source_hash && options == key.options &&
+               device_name == key.device_name && driver_version == key.driver_version && platform == key.platform;
+  if (valid){
+    binary.resize(static_cast<size_t>(strtoull(size_str.c_str(), nullptr, 10)));
+    file.read(reinterpret_cast<char*>(binary.data()), binary.size());
+    valid = !binary.empty() && file.gcount() == static_cast<std::streamsize>(binary.size());
+  }
+  file.close();
+
+  cl_program program = 0;
+  if (valid){
+    cl_int error = 0, binary_status = 0;
+    size_t binary_size = binary.size();
+    const unsigned char* binary_ptr = binary.data();
+    program = clCreateProgramWithBinary(device.ctx, 1, &device.id, &binary_size, &binary_ptr, &binary_status, &error);
+    if (error == CL_SUCCESS && binary_status == CL_SUCCESS)
+      error = cl->compileProgram(program, device, key.options);
+    if (error != CL_SUCCESS || binary_status != CL_SUCCESS){
+      if (program)
+        clReleaseProgram(program);
+      program = 0;
+    }
+  }
+
+  if (!program){
+    std::cout << "Program cache: invalidating " << file_path << std::endl;
+    remove(file_path.c_str());
+  }
+  return program;
+}
+
+void ClProgramCache::store(ClContext* cl, const Key& key, cl_program program) {
+  cl_int error = 0;
+
+  // the program is built for this device only.
+  size_t binary_size = 0;
+  error = clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t), &binary_size, nullptr);  cl->checkError(error);
+  if (error != CL_SUCCESS || binary_size == 0)
+    return;
+  std::vector<unsigned char> binary(binary_size);
+  unsigned char* binary_ptr = binary.data();
+  error = clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(unsigned char*), &binary_ptr, nullptr); cl->checkError(error);
+  if (error != CL_SUCCESS)
+    return;
+
+  std::string file_path = path(key);
+  // unique per process and thread
+  std::ostringstream tmp_path_ss;
+#ifdef _WIN32
+  tmp_path_ss << file_path << ".tmp" << _getpid() << "_" << boost::this_thread::get_id();
+#else
+  tmp_path_ss << file_path << ".tmp" << getpid() << "_" << boost::this_thread::get_id();
+#endif
+  std::string tmp_path = tmp_path_ss.str();
+
+  std::ofstream file(tmp_path.c_str(), std::ios::binary);
+  if (!file){
+    std::cerr << "Program cache: cannot write " << tmp_path << std::endl;
+    return;
+  }
+  file << cache_magic << "\n" << key.source_hash << "\n" << key.options << "\n" << key.device_name << "\n"
+       << key.driver_version << "\n" << key.platform << "\n" << binary_size << "\n";
+  file.write(reinterpret_cast<const char*>(binary.data()), binary.size());
+  file.close();
+  if (!file){
+    remove(tmp_path.c_str());
+    return;
+  }
+
+#ifdef _WIN32
+  // rename does not replace an existing file on Windows.
+  remove(file_path.c_str());
+#endif
+  if (rename(tmp_path.c_str(), file_path.c_str()) != 0)
+    remove(tmp_path.c_str());
+}
+
+cl_program ClProgramCache::build(ClContext* cl, const ClDevice& device, const std::string& file_name, const std::string& source,
+                                 const std::string& options, std::string* build_log, cl_int* build_error) {
+  HostClock::time_point beg_time = HostClock::now();
+  Key key = makeKey(device, source, options);
+
+  cl_int error = CL_SUCCESS;
+  cl_program program = load(cl, device, key);
+  bool hit = program != 0;
+  if (!program){
+    const char* source_cstr = source.c_str();
+    program = clCreateProgramWithSource(device.ctx, 1, &source_cstr, nullptr, &error);   cl->checkError(error);
+    if (error != CL_SUCCESS){
+      if (build_error)
+        *build_error = error;
+      return 0;
+    }
+    error = cl->compileProgram(program, device, options);                               cl->checkError(error);
+  }
+  if (build_log)
+    *build_log = cl->getBuildLog(program, device);
+  if (build_error)
+    *build_error = error;
+
+  if (error != CL_SUCCESS){
+    clReleaseProgram(program);
+    program = 0;
+  }
+  else if (!hit)
+    store(cl, key, program);
+
+  ClProgramCacheEntry entry;
+  entry.file_name = file_name;
+  entry.device_name = key.device_name;
+  entry.hit = hit;
+  entry.duration_ms = elapsedMs(beg_time, HostClock::now());
+  boost::lock_guard<boost::mutex> lock(m_entries_mutex);
+  m_entries.push_back(entry);
+  return program;
+}
+
+std::vector<ClProgramCacheEntry> ClProgramCache::entries() const {
+  boost::lock_guard<boost::mutex> lock(m_entries_mutex);
+  return m_entries;
+}
+
+void ClProgramCache::printReport() const {
+  boost::lock_guard<boost::mutex> lock(m_entries_mutex);
+  size_t hits = 0;
+  double hit_ms = 0.0, build_ms = 0.0;
+  std::cout << "Program cache (" << m_directory << "):\n";
+  for (size_t i = 0; i < m_entries.size(); i++){
+    const ClProgramCacheEntry& entry = m_entries[i];
+    std::cout << "\t" << (entry.hit ? "hit  " : "build") << "\t" << entry.duration_ms << " ms\t"
+              << entry.file_name << "\t" << entry.device_name << "\n";
+    if (entry.hit){
+      hits++;
+      hit_ms += entry.duration_ms;
+    }
+    else
+      build_ms += entry.duration_ms;
+  }
+  std::cout << "\t" << hits << " hits (" << hit_ms << " ms), " << m_entries.size() - hits << " cold builds (" << build_ms << " ms)\n";
+}
@@ -0,0 +1,59 @@
+#ifndef __CL_PROGRAM_CACHE_H__
+#define __CL_PROGRAM_CACHE_H__
+
+// STD
+#include <vector>
+#include <string>
+
+// BOOST
+#include <boost/thread/mutex.hpp>
+
+#include "ClContext.h"
+
+// One program requested through the cache, for the startup report.
+struct ClProgramCacheEntry {
+  std::string file_name;
+  std::string device_name;
+  bool        hit;            // loaded from a binary, no compilation from source
+  double      duration_ms;    // load or build time
+};
+
+// On-disk cache of program binaries (CL_PROGRAM_BINARIES).
+// A binary is keyed on the source, the build options, the device name, the driver version and
+// the platform. The key fields are stored next to the binary and compared on load, any mismatch
+// or a binary rejected by the driver invalidates the file and the program is built from source.
+// Files are written to a temporary name and renamed, so a concurrent reader never sees half a file.
+// build may be called from several threads.
+class ClProgramCache {
+public:
+  ClProgramCache(const std::string& directory);
+
+  // Returns a built program for device, 0 if the source does not build.
+  // build_log and error receive the build log and the build result, if given.
+  cl_program build(ClContext* cl, const ClDevice& device, const std::string& file_name, const std::string& source,
+                   const std::string& options, std::string* build_log = nullptr, cl_int* error = nullptr);
+
+  void printReport() const;
+
+  std::vector<ClProgramCacheEntry> entries() const;
+
+private:
+  struct Key {
+    std::string source_hash;
+    std::string options;
+    std::string device_name;
+    std::string driver_version;
+    std::string platform;
+  };
+
+  Key makeKey(const ClDevice& device, const std::string& source, const std::string& options) const;
+  std::string path(const Key& key) const;
+  cl_program load(ClContext* cl, const ClDevice& device, const Key& key);
+  void store(ClContext* cl, const Key& key, cl_program program);
+
+  std::string                       m_directory;
+  std::vector<ClProgramCacheEntry>  m_entries;
+  mutable boost::mutex              m_entries_mutex;
+};
+
+#endif
@@ -0,0 +1,81 @@
+#include "DeviceProfile.h"
+#include "TransferStrategy.h"
+
+// STD
+#include <iostream>
+#include <algorithm>
+
+BenchRecord deviceProfileRecord(const ClDevice& device) {
+  const ClDeviceFeatures& features = device.features;
+
+  std::string extensions;
+  for (std::set<std::string>::const_iterator it = features.extensions.begin(); it != features.extensions.end(); ++it)
+    extensions += (extensions.empty() ? "" : " ") + *it;
+
+  BenchRecord record;
+  record.set("device", features.device_name);
+  record.set("platform", features.platform_name);
+  record.set("vendor", features.vendor);
+  record.set("device_version", features.device_version);
+  record.set("driver_version", features.driver_version);
+  record.set("device_type", static_cast<long long>(features.device_type));
+  record.set("profile_key", features.profileKey());
+  record.set("global_mem_size", static_cast<long long>(features.global_mem_size));
+  record.set("local_mem_size", static_cast<long long>(features.local_mem_size));
+  record.set("max_mem_alloc_size", static_cast<long long>(features.max_mem_alloc_size));
+  record.set("max_constant_buffer_size", static_cast<long long>(features.max_constant_buffer_size));
+  record.set("global_mem_cache_size", static_cast<long long>(features.global_mem_cache_size));
+  record.set("global_mem_cacheline_size", static_cast<long long>(features.global_mem_cacheline_size));
+  record.set("mem_base_addr_align", static_cast<long long>(features.mem_base_addr_align));
+  record.set("host_unified_memory", features.host_unified_memory);
+  record.set("max_compute_units", static_cast<long long>(features.max_compute_units));
+  record.set("max_work_group_size", features.max_work_group_size);
+  record.set("max_clock_frequency", static_cast<long long>(features.max_clock_frequency));
+  record.set("preferred_vector_width_char", static_cast<long long>(features.preferred_vector_width_char));
+  record.set("preferred_vector_width_short", static_cast<long long>(features.preferred_vector_width_short));
+  record.set("preferred_vector_width_int", static_cast<long long>(features.preferred_vector_width_int));
+  record.set("preferred_vector_width_float", static_cast<long long>(features.preferred_vector_width_float));
+  record.set("preferred_vector_width_double", static_cast<long long>(features.preferred_vector_width_double));
+  record.set("svm_capabilities", static_cast<long long>(features.svm_capabilities));
+  record.set("out_of_order_queues", (features.queue_capabilities & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE) != 0);
+  record.set("has_cl_khr_gl_sharing", features.has_cl_khr_gl_sharing);
+  record.set("extensions", extensions);
+  return record;
+}
+
+std::vector<std::string> autoModes(const ClDeviceFeatures& features) {
+  std::vector<std::string> modes;
+  // SVM avoids the read back where the device works on host memory anyway.
+  if (features.host_unified_memory || (features.device_type & CL_DEVICE_TYPE_CPU)){
+    if (features.svm_capabilities & CL_DEVICE_SVM_FINE_GRAIN_BUFFER)
+      modes.push_back("svm_fine");
+    else if (features.svm_capabilities & CL_DEVICE_SVM_COARSE_GRAIN_BUFFER)
+      modes.push_back("svm");
+  }
+  modes.push_back("read");
+
+  // the GL context is set up before the devices are known, from --mode as given: "auto" never
+  // gets one, so it must not resolve to a GL strategy.
+  std::vector<std::string> without_gl;
+  for (size_t m = 0; m < modes.size(); m++){
+    if (!transferStrategyNeedsGl(modes[m]))
+      without_gl.push_back(modes[m]);
+  }
+  return without_gl;
+}
+
+size_t maxFittingSize(const ClDeviceFeatures& features) {
+  return static_cast<size_t>(std::min(features.max_mem_alloc_size, features.global_mem_size / 4) / sizeof(cl_float4));
+}
+
+std::vector<size_t> fitSizes(const ClDeviceFeatures& features, const std::vector<size_t>& sizes) {
+  size_t max_elements = maxFittingSize(features);
+  std::vector<size_t> fitting;
+  for (size_t s = 0; s < sizes.size(); s++){
+    if (sizes[s] <= max_elements)
+      fitting.push_back(sizes[s]);
+    else
+      std::cout << "Skipping " << sizes[s] << " elements, " << features.device_name << " fits at most " << max_elements << ".\n";
+  }
+  return fitting;
+}
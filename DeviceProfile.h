@@ -0,0 +1,26 @@
+#ifndef __DEVICE_PROFILE_H__
+#define __DEVICE_PROFILE_H__
+
+// STD
+#include <vector>
+#include <string>
+
+#include "ClContext.h"
+#include "BenchReport.h"
+
+// All fields of the device features as one JSON record.
+BenchRecord deviceProfileRecord(const ClDevice& device);
+
+// Transfer strategies without GL that suit the device: SVM (fine grained if supported) on CPUs and
+// memory shared with the host, and the plain read back as the baseline. Replaces "auto" in --mode,
+// which does not create a GL context (see modesNeedGl), so GL strategies are never picked.
+std::vector<std::string> autoModes(const ClDeviceFeatures& features);
+
+// Drops the float4 element counts that do not fit the device: each buffer has to fit
+// CL_DEVICE_MAX_MEM_ALLOC_SIZE and both of them a quarter of the global memory.
+std::vector<size_t> fitSizes(const ClDeviceFeatures& features, const std::vector<size_t>& sizes);
+
+// largest float4 element count fitSizes accepts.
+size_t maxFittingSize(const ClDeviceFeatures& features);
+
+#endif
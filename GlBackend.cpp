@@ -0,0 +1,629 @@
+#include "GlBackend.h"
+
+// STD
+#include <iostream>
+
+#ifdef _WIN32
+  #include <windows.h>
+  #include <wingdi.h>
+  #include <GLFW/glfw3.h>
+#elif _LINUX
+  #include <stdio.h>
+  #include <stdlib.h>
+  #include <string.h>
+  #include <X11/Xlib.h>
+  #include <X11/Xutil.h>
+  #include <GL/gl.h>
+  #include <GL/glx.h>
+  #include <EGL/egl.h>
+  #include <EGL/eglext.h>
+#endif
+
+#ifdef _WIN32
+//===============================
+// GLFW
+//===============================
+// glfwTerminate destroys every window, it waits for the last one.
+static int glfw_windows = 0;
+
+class GlfwBackend : public GlBackend {
+public:
+  GlfwBackend() : m_win(0), m_hdc(0), m_ctx(0) {}
+
+  ~GlfwBackend() {
+    if (m_win){
+      glfwDestroyWindow(m_win);
+      if (--glfw_windows == 0)
+        glfwTerminate();
+    }
+  }
+
+  const char* name() const { return "glfw"; }
+  std::string description() const { return "glfw"; }
+
+  bool create() {
+    if (!glfwInit()){
+      std::cerr << "Cannot init GLFW\n";
+      return false;
+    }
+
+    // the buffers are never drawn, the window stays hidden.
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    m_win = glfwCreateWindow(600, 400, "TEST GPU Buffer", NULL, NULL);
+    if (!m_win){
+      std::cerr << "Cannot create the GLFW window\n";
+      if (glfw_windows == 0)
+        glfwTerminate();
+      return false;
+    }
+    glfw_windows++;
+
+    // Make the current window as the current gl context
+    glfwMakeContextCurrent(m_win);
+    m_hdc = wglGetCurrentDC();
+    m_ctx = wglGetCurrentContext();
+    return true;
+  }
+
+  bool makeCurrent() const {
+    glfwMakeContextCurrent(m_win);
+    return true;
+  }
+
+  void doneCurrent() const { glfwMakeContextCurrent(NULL); }
+
+  void appendClProperties(std::vector<cl_context_properties>& properties) const {
+    properties.push_back(CL_WGL_HDC_KHR);
+    properties.push_back((cl_context_properties)m_hdc);
+    properties.push_back(CL_GL_CONTEXT_KHR);
+    properties.push_back((cl_context_properties)m_ctx);
+  }
+
+private:
+  GLFWwindow* m_win;
+  HDC         m_hdc;
+  HGLRC       m_ctx;
+};
+
+#elif _LINUX
+
+// Helper to check for extension string presence.  Adapted from:
+//   http://www.opengl.org/resources/features/OGLextensions/
+static bool isExtensionSupported(const char *extList, const char *extension)
+{
+  const char *start;
+  const char *where, *terminator;
+
+  if (!extList)
+    return false;
+
+  /* Extension names should not have spaces. */
+  where = strchr(extension, ' ');
+  if (where || *extension == '\0')
+    return false;
+
+  /* It takes a bit of care to be fool-proof about parsing the
+     OpenGL extensions string. Don't be fooled by sub-strings,
+     etc. */
+  for (start=extList;;) {
+    where = strstr(start, extension);
+
+    if (!where)
+      break;
+
+    terminator = where + strlen(extension);
+
+    if ( where == start || *(where - 1) == ' ' )
+      if ( *terminator == ' ' || *terminator == '\0' )
+        return true;
+
+    start = terminator;
+  }
+
+  return false;
+}
+
+//===============================
+// GLX
+//===============================
+#define GLX_CONTEXT_MAJOR_VERSION_ARB       0x2091
+#define GLX_CONTEXT_MINOR_VERSION_ARB       0x2092
+typedef GLXContext (*glXCreateContextAttribsARBProc)(Display*, GLXFBConfig, GLXContext, Bool, const int*);
+
+static bool ctxErrorOccurred = false;
+static int ctxErrorHandler( Display *dpy, XErrorEvent *ev )
+{
+    ctxErrorOccurred = true;
+    return 0;
+}
+
+class GlxBackend : public GlBackend {
+public:
+  GlxBackend(const std::string& display_str) : m_display_str(display_str), m_display(0), m_win(0), m_ctx(0) {}
+
+  ~GlxBackend() {
+    if (!m_display)
+      return;
+    if (m_ctx){
+      glXMakeCurrent(m_display, None, 0);
+      glXDestroyContext(m_display, m_ctx);
+    }
+    if (m_win)
+      XDestroyWindow(m_display, m_win);
+    XCloseDisplay(m_display);
+  }
+
+  const char* name() const { return "glx"; }
+
+  std::string description() const {
+    if (m_display)
+      return std::string("glx ") + DisplayString(m_display);
+    return "glx " + m_display_str;
+  }
+
+  bool create();
+
+  bool makeCurrent() const { return glXMakeCurrent(m_display, m_win, m_ctx) == True; }
+  void doneCurrent() const { glXMakeCurrent(m_display, None, 0); }
+
+  void appendClProperties(std::vector<cl_context_properties>& properties) const {
+    properties.push_back(CL_GLX_DISPLAY_KHR);
+    properties.push_back((cl_context_properties)m_display);
+    properties.push_back(CL_GL_CONTEXT_KHR);
+    properties.push_back((cl_context_properties)m_ctx);
+  }
+
+private:
+  std::string m_display_str;    // empty for $DISPLAY
+  Display*    m_display;
+  Window      m_win;
+  GLXContext  m_ctx;
+};
+
+bool GlxBackend::create() {
+    m_display = XOpenDisplay(m_display_str.empty() ? NULL : m_display_str.c_str());
+
+    if (!m_display)
+    {
+      printf("Failed to open X display %s\n", m_display_str.empty() ? "$DISPLAY" : m_display_str.c_str());
+      return false;
+    }
+    Display* display = m_display;
+
+    // Get a matching FB config
+    static int visual_attribs[] =
+      {
+        GLX_X_RENDERABLE    , True,
+        GLX_DRAWABLE_TYPE   , GLX_WINDOW_BIT,
+        GLX_RENDER_TYPE     , GLX_RGBA_BIT,
+        GLX_X_VISUAL_TYPE   , GLX_TRUE_COLOR,
+        GLX_RED_SIZE        , 8,
+        GLX_GREEN_SIZE      , 8,
+        GLX_BLUE_SIZE       , 8,
+        GLX_ALPHA_SIZE      , 8,
+        GLX_DEPTH_SIZE      , 24,
+        GLX_STENCIL_SIZE    , 8,
+        GLX_DOUBLEBUFFER    , True,
+        //GLX_SAMPLE_BUFFERS  , 1,
+        //GLX_SAMPLES         , 4,
+        None
+      };
+
+    int glx_major, glx_minor;
+
+    // FBConfigs were added in GLX version 1.3.
+    if ( !glXQueryVersion( display, &glx_major, &glx_minor ) ||
+         ( ( glx_major == 1 ) && ( glx_minor < 3 ) ) || ( glx_major < 1 ) )
+    {
+      printf("Invalid GLX version\n");
+      return false;
+    }
+
+    printf( "Getting matching framebuffer configs\n" );
+    int fbcount;
+    GLXFBConfig* fbc = glXChooseFBConfig(display, DefaultScreen(display), visual_attribs, &fbcount);
+    if (!fbc)
+    {
+      printf( "Failed to retrieve a framebuffer config\n" );
+      return false;
+    }
+    printf( "Found %d matching FB configs.\n", fbcount );
+
+    // Pick the FB config/visual with the most samples per pixel
+    printf( "Getting XVisualInfos\n" );
+    int best_fbc = -1, worst_fbc = -1, best_num_samp = -1, worst_num_samp = 999;
+
+    int i;
+    for (i=0; i<fbcount; ++i)
+    {
+      XVisualInfo *vi = glXGetVisualFromFBConfig( display, fbc[i] );
+      if ( vi )
+      {
+        int samp_buf, samples;
+        glXGetFBConfigAttrib( display, fbc[i], GLX_SAMPLE_BUFFERS, &samp_buf );
+        glXGetFBConfigAttrib( display, fbc[i], GLX_SAMPLES       , &samples  );
+
+        printf( "  Matching fbconfig %d, visual ID 0x%2x: SAMPLE_BUFFERS = %d,"
+                " SAMPLES = %d\n",
+                i, (unsigned int)vi -> visualid, samp_buf, samples );
+
+        if ( best_fbc < 0 || (samp_buf && samples > best_num_samp) )
+          best_fbc = i, best_num_samp = samples;
+        if ( worst_fbc < 0 || !samp_buf || samples < worst_num_samp )
+          worst_fbc = i, worst_num_samp = samples;
+      }
+      XFree( vi );
+    }
+
+    GLXFBConfig bestFbc = fbc[ best_fbc ];
+
+    // Be sure to free the FBConfig list allocated by glXChooseFBConfig()
+    XFree( fbc );
+
+    // Get a visual
+    XVisualInfo *vi = glXGetVisualFromFBConfig( display, bestFbc );
+    printf( "Chosen visual ID = 0x%x\n", (unsigned int)vi->visualid );
+
+    printf( "Creating colormap\n" );
+    XSetWindowAttributes swa;
+    Colormap cmap;
+    swa.colormap = cmap = XCreateColormap( display,
+                                           RootWindow( display, vi->screen ),
+                                           vi->visual, AllocNone );
+    swa.background_pixmap = None ;
+    swa.border_pixel      = 0;
+    swa.event_mask        = StructureNotifyMask;
+
+    printf( "Creating window\n" );
+    m_win = XCreateWindow( display, RootWindow( display, vi->screen ),
+                                0, 0, 100, 100, 0, vi->depth, InputOutput,
+                                vi->visual,
+                                CWBorderPixel|CWColormap|CWEventMask, &swa );
+    if ( !m_win )
+    {
+      printf( "Failed to create window.\n" );
+      XFree( vi );
+      return false;
+    }
+
+    // Done with the visual info data
+    XFree( vi );
+
+    XStoreName( display, m_win, "GL 3.0 Window" );
+
+    printf( "Mapping window\n" );
+    XMapWindow( display, m_win );
+
+    // Get the default screen's GLX extension list
+    const char *glxExts = glXQueryExtensionsString( display,
+                                                    DefaultScreen( display ) );
+
+    // NOTE: It is not necessary to create or make current to a context before
+    // calling glXGetProcAddressARBWindow
+    glXCreateContextAttribsARBProc glXCreateContextAttribsARB = 0;
+    glXCreateContextAttribsARB = (glXCreateContextAttribsARBProc)
+             glXGetProcAddressARB( (const GLubyte *) "glXCreateContextAttribsARB" );
+
+    GLXContext ctx = 0;
+
+    // Install an X error handler so the application won't exit if GL 3.0
+    // context allocation fails.
+    //
+    // Note this error handler is global.  All display connections in all threads
+    // of a process use the same error handler, so be sure to guard against other
+    // threads issuing X commands while this code is running.
+    ctxErrorOccurred = false;
+    int (*oldHandler)(Display*, XErrorEvent*) =
+        XSetErrorHandler(&ctxErrorHandler);
+
+    // Check for the GLX_ARB_create_context extension string and the function.
+    // If either is not present, use GLX 1.3 context creation method.
+    if ( !isExtensionSupported( glxExts, "GLX_ARB_create_context" ) ||
+         !glXCreateContextAttribsARB )
+    {
+      printf( "glXCreateContextAttribsARB() not found"
+              " ... using old-style GLX context\n" );
+      ctx = glXCreateNewContext( display, bestFbc, GLX_RGBA_TYPE, 0, True );
+    }
+
+    // If it does, try to get a GL 3.0 context!
+    else
+    {
+      int context_attribs[] =
+        {
+          GLX_CONTEXT_MAJOR_VERSION_ARB, 3,
+          GLX_CONTEXT_MINOR_VERSION_ARB, 0,
+          //GLX_CONTEXT_FLAGS_ARB        , GLX_CONTEXT_FORWARD_COMPATIBLE_BIT_ARB,
+          None
+        };
+
+      printf( "Creating context\n" );
+      ctx = glXCreateContextAttribsARB( display, bestFbc, 0,
+                                        True, context_attribs );
+
+      // Sync to ensure any errors generated are processed.
+      XSync( display, False );
+      if ( !ctxErrorOccurred && ctx )
+        printf( "Created GL 3.0 context\n" );
+      else
+      {
+        // Couldn't create GL 3.0 context.  Fall back to old-style 2.x context.
+        // When a context version below 3.0 is requested, implementations will
+        // return the newest context version compatible with OpenGL versions less
+        // than version 3.0.
+        // GLX_CONTEXT_MAJOR_VERSION_ARB = 1
+        context_attribs[1] = 1;
+        // GLX_CONTEXT_MINOR_VERSION_ARB = 0
+        context_attribs[3] = 0;
+
+        ctxErrorOccurred = false;
+
+        printf( "Failed to create GL 3.0 context"
+                " ... using old-style GLX context\n" );
+        ctx = glXCreateContextAttribsARB( display, bestFbc, 0,
+                                          True, context_attribs );
+      }
+    }
+
+    // Sync to ensure any errors generated are processed.
+    XSync( display, False );
+
+    // Restore the original error handler
+    XSetErrorHandler( oldHandler );
+
+    if ( ctxErrorOccurred || !ctx )
+    {
+      printf( "Failed to create an OpenGL context\n" );
+      return false;
+    }
+    m_ctx = ctx;
+
+    // Verifying that context is a direct context
+    if ( ! glXIsDirect ( display, ctx ) )
+    {
+      printf( "Indirect GLX rendering context obtained\n" );
+    }
+    else
+    {
+      printf( "Direct GLX rendering context obtained\n" );
+    }
+
+    printf( "Making context current\n" );
+    return glXMakeCurrent( display, m_win, ctx ) == True;
+}
+
+//===============================
+// EGL
+//===============================
+class EglBackend : public GlBackend {
+public:
+  // device_index: of EGL_EXT_device_enumeration, -1 for the default display.
+  EglBackend(int device_index) :
+    m_device_index(device_index), m_display(EGL_NO_DISPLAY), m_surface(EGL_NO_SURFACE), m_ctx(EGL_NO_CONTEXT) {}
+
+  ~EglBackend() {
+    if (m_display == EGL_NO_DISPLAY)
+      return;
+    eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (m_ctx != EGL_NO_CONTEXT)
+      eglDestroyContext(m_display, m_ctx);
+    if (m_surface != EGL_NO_SURFACE)
+      eglDestroySurface(m_display, m_surface);
+    eglTerminate(m_display);
+  }
+
+  const char* name() const { return "egl"; }
+
+  std::string description() const {
+    if (m_device_index < 0)
+      return "egl";
+    return "egl device " + std::to_string(static_cast<long long>(m_device_index));
+  }
+
+  bool create();
+
+  // the current API is a per-thread state of EGL.
+  bool makeCurrent() const { return eglBindAPI(EGL_OPENGL_API) && eglMakeCurrent(m_display, m_surface, m_surface, m_ctx) == EGL_TRUE; }
+  void doneCurrent() const { eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT); }
+
+  void appendClProperties(std::vector<cl_context_properties>& properties) const {
+    properties.push_back(CL_EGL_DISPLAY_KHR);
+    properties.push_back((cl_context_properties)m_display);
+    properties.push_back(CL_GL_CONTEXT_KHR);
+    properties.push_back((cl_context_properties)m_ctx);
+  }
+
+private:
+  // the default display, else the Mesa surfaceless platform, which needs neither X nor a GPU.
+  bool openDisplay();
+  // the display of one GPU, EGL_EXT_platform_device
+  bool openDeviceDisplay();
+
+  int         m_device_index;
+  EGLDisplay  m_display;
+  EGLSurface  m_surface;    // EGL_NO_SURFACE with EGL_KHR_surfaceless_context
+  EGLContext  m_ctx;
+};
+
+bool EglBackend::openDeviceDisplay() {
+  const char* client_exts = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  PFNEGLQUERYDEVICESEXTPROC eglQueryDevicesEXT = (PFNEGLQUERYDEVICESEXTPROC)eglGetProcAddress("eglQueryDevicesEXT");
+  PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT =
+    (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+  if (!isExtensionSupported(client_exts, "EGL_EXT_device_enumeration") || !isExtensionSupported(client_exts, "EGL_EXT_platform_device")
+      || !eglQueryDevicesEXT || !eglGetPlatformDisplayEXT){
+    std::cerr << "EGL devices cannot be enumerated (EGL_EXT_device_enumeration, EGL_EXT_platform_device)\n";
+    return false;
+  }
+
+  EGLint num_devices = 0;
+  eglQueryDevicesEXT(0, nullptr, &num_devices);
+  if (m_device_index >= num_devices){
+    std::cerr << "There are " << num_devices << " EGL devices, no device " << m_device_index << std::endl;
+    return false;
+  }
+  std::vector<EGLDeviceEXT> egl_devices(num_devices);
+  eglQueryDevicesEXT(num_devices, egl_devices.data(), &num_devices);
+
+  EGLint major, minor;
+  m_display = eglGetPlatformDisplayEXT(EGL_PLATFORM_DEVICE_EXT, egl_devices[m_device_index], nullptr);
+  return m_display != EGL_NO_DISPLAY && eglInitialize(m_display, &major, &minor);
+}
+
+bool EglBackend::openDisplay() {
+  if (m_device_index >= 0)
+    return openDeviceDisplay();
+
+  EGLint major, minor;
+  m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  if (m_display != EGL_NO_DISPLAY && eglInitialize(m_display, &major, &minor))
+    return true;
+
+  // client extensions are queried without a display, NULL before EGL 1.5 / EGL_EXT_client_extensions.
+  const char* client_exts = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT =
+    (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+  if (!isExtensionSupported(client_exts, "EGL_MESA_platform_surfaceless") || !eglGetPlatformDisplayEXT)
+    return false;
+
+  m_display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, nullptr, nullptr);
+  return m_display != EGL_NO_DISPLAY && eglInitialize(m_display, &major, &minor);
+}
+
+bool EglBackend::create() {
+  if (!openDisplay()){
+    std::cerr << "Cannot initialize an EGL display\n";
+    m_display = EGL_NO_DISPLAY;
+    return false;
+  }
+  std::cout << "EGL " << eglQueryString(m_display, EGL_VERSION) << ", " << eglQueryString(m_display, EGL_VENDOR) << std::endl;
+
+  if (!eglBindAPI(EGL_OPENGL_API)){
+    std::cerr << "The EGL display does not support desktop OpenGL\n";
+    return false;
+  }
+
+  // the buffers are never drawn, without a surface if the display allows it, else into a 1x1 pbuffer.
+  const char* display_exts = eglQueryString(m_display, EGL_EXTENSIONS);
+  bool surfaceless = isExtensionSupported(display_exts, "EGL_KHR_surfaceless_context");
+  EGLint config_attribs[] = {
+    EGL_SURFACE_TYPE,     surfaceless ? 0 : EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE,  EGL_OPENGL_BIT,
+    EGL_RED_SIZE,         8,
+    EGL_GREEN_SIZE,       8,
+    EGL_BLUE_SIZE,        8,
+    EGL_ALPHA_SIZE,       8,
+    EGL_NONE
+  };
+  EGLConfig config;
+  EGLint num_configs = 0;
+  if (!eglChooseConfig(m_display, config_attribs, &config, 1, &num_configs) || num_configs == 0){
+    std::cerr << "No EGL config with desktop OpenGL\n";
+    return false;
+  }
+
+  if (!surfaceless){
+    EGLint pbuffer_attribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+    m_surface = eglCreatePbufferSurface(m_display, config, pbuffer_attribs);
+    if (m_surface == EGL_NO_SURFACE){
+      std::cerr << "Cannot create the EGL pbuffer\n";
+      return false;
+    }
+  }
+
+  // a GL 3.0 context like the GLX backend, the newest compatible one if that fails.
+  if (isExtensionSupported(display_exts, "EGL_KHR_create_context")){
+    EGLint context_attribs[] = { EGL_CONTEXT_MAJOR_VERSION_KHR, 3, EGL_CONTEXT_MINOR_VERSION_KHR, 0, EGL_NONE };
+    m_ctx = eglCreateContext(m_display, config, EGL_NO_CONTEXT, context_attribs);
+  }
+  if (m_ctx == EGL_NO_CONTEXT)
+    m_ctx = eglCreateContext(m_display, config, EGL_NO_CONTEXT, nullptr);
+  if (m_ctx == EGL_NO_CONTEXT){
+    std::cerr << "Cannot create the EGL context\n";
+    return false;
+  }
+
+  std::cout << "Created " << (surfaceless ? "surfaceless" : "pbuffer") << " EGL context\n";
+  return eglMakeCurrent(m_display, m_surface, m_surface, m_ctx) == EGL_TRUE;
+}
+#endif
+
+GlBackend* createGlBackend(const std::string& name, const std::string& display) {
+#ifdef _WIN32
+  if (name == "auto" || name == "glfw")
+    return new GlfwBackend();
+#elif _LINUX
+  std::string backend = name;
+  if (backend == "auto"){
+    const char* env_display = getenv("DISPLAY");
+    backend = (!display.empty() || (env_display && *env_display)) ? "glx" : "egl";
+  }
+  if (backend == "glx"){
+    // the contexts are made current from the benchmark threads.
+    static bool x_threads = XInitThreads() != 0;
+    if (!x_threads)
+      return nullptr;
+    return new GlxBackend(display);
+  }
+  if (backend == "egl"){
+    int device_index = -1;
+    if (!display.empty()){
+      char* end = 0;
+      device_index = static_cast<int>(strtol(display.c_str(), &end, 10));
+      if (*end != '\0' || device_index < 0)
+        return nullptr;
+    }
+    return new EglBackend(device_index);
+  }
+#endif
+  return nullptr;
+}
+
+static GlBackend* initGlBackend(const std::string& name, const std::string& display) {
+  GlBackend* gl = createGlBackend(name, display);
+  if (!gl){
+    std::cerr << "No GL backend " << name << " for display \"" << display << "\"\n";
+    return nullptr;
+  }
+
+  if (!gl->create()){
+#ifdef _LINUX
+    // an X display that is set but not reachable, e.g. a stale $DISPLAY on a compute node.
+    if (name == "auto" && std::string(gl->name()) == "glx"){
+      std::cout << "Falling back to EGL\n";
+      delete gl;
+      gl = new EglBackend(-1);
+      if (gl->create())
+        return gl;
+    }
+#endif
+    std::cerr << "Cannot create the " << gl->description() << " OpenGL context\n";
+    delete gl;
+    return nullptr;
+  }
+
+  std::cout << "OpenGL context: " << gl->description() << ", " << glGetString(GL_VERSION) << ", " << glGetString(GL_RENDERER) << std::endl;
+  return gl;
+}
+
+std::vector<GlBackend*> initGlBackends(const std::string& name, const std::vector<std::string>& displays) {
+  std::vector<GlBackend*> contexts;
+  std::vector<std::string> names = displays;
+  if (names.empty())
+    names.push_back("");
+
+  for (size_t i = 0; i < names.size(); i++){
+    GlBackend* gl = initGlBackend(name, names[i]);
+    if (!gl){
+      for (size_t c = 0; c < contexts.size(); c++)
+        delete contexts[c];
+      contexts.clear();
+      return contexts;
+    }
+    contexts.push_back(gl);
+  }
+
+  if (contexts.size() > 1)
+    contexts[0]->makeCurrent();
+  return contexts;
+}
@@ -0,0 +1,45 @@
+#ifndef __GL_BACKEND_H__
+#define __GL_BACKEND_H__
+
+// STD
+#include <string>
+#include <vector>
+
+#include "ClContext.h"
+
+// The OpenGL context of the interop strategies and the window system it comes from:
+//   glx   an X11 window, needs an X server
+//   egl   a pbuffer or surfaceless EGL context, runs without X (e.g. Mesa llvmpipe on GPU-less hosts)
+//         GLEW has to be built with GLEW_EGL, a GLX build only loads through libglvnd (see main.cpp)
+//   glfw  a hidden GLFW window (Windows)
+class GlBackend {
+public:
+  virtual ~GlBackend() {}
+
+  virtual const char* name() const = 0;
+  // name and display, e.g. "glx :0.1"
+  virtual std::string description() const = 0;
+
+  // Creates the context and makes it current on the calling thread. false on failure, after printing why.
+  virtual bool create() = 0;
+
+  // A context is current on at most one thread: doneCurrent on one thread before makeCurrent on another.
+  virtual bool makeCurrent() const = 0;
+  virtual void doneCurrent() const = 0;
+
+  // appends the CL_GL_CONTEXT_KHR and display properties for clCreateContext.
+  virtual void appendClProperties(std::vector<cl_context_properties>& properties) const = 0;
+};
+
+// Returns the backend called name, nullptr for an unknown name. "auto" is glx if an X display is
+// set (display, else $DISPLAY) and egl otherwise on Linux, glfw on Windows.
+// display is the X display of glx and the index of the EGL device (EGL_EXT_device_enumeration) of egl,
+// empty for the default one.
+GlBackend* createGlBackend(const std::string& name, const std::string& display);
+
+// Creates one context of backend name per entry of displays, or a single default one if displays is
+// empty. auto falls back to egl if glx fails. The first context is current afterwards.
+// Empty if any of them fails.
+std::vector<GlBackend*> initGlBackends(const std::string& name, const std::vector<std::string>& displays);
+
+#endif
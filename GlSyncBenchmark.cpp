@@ -0,0 +1,78 @@
+#include "GlSyncBenchmark.h"
+#include "Benchmark.h"
+#include "ClProfiling.h"
+
+// STD
+#include <iostream>
+
+static const char* const sync_modes[] = { "gl", "gl_fence", "gl_implicit" };
+
+// Iterations per second of options.iterations back to back iterations, after the warmup.
+// flush_each: clFinish after every iteration, like the latency runs.
+static double measureThroughput(ClContext* cl, const ClDevice& device, cl_kernel kernel, const BenchOptions& options,
+                                TransferStrategy& strategy, size_t mem_size, bool flush_each) {
+  cl_int error;
+  size_t local_ws = options.local_ws;
+  size_t work_items = ClKernelVariant().workItems(mem_size * sizeof(cl_float4));
+  size_t global_ws = (work_items + local_ws - 1) / local_ws * local_ws;
+  setTransferKernelArgs(kernel, strategy, mem_size, local_ws);
+
+  HostClock::time_point beg = HostClock::now();
+  for (int i = 0; i < options.warmup + options.iterations; i++){
+    if (i == options.warmup){
+      clFinish(device.cmd_queue);
+      beg = HostClock::now();
+    }
+    IterationEvents events(false);
+    IterationTiming timing;
+    strategy.beforeKernel(events, timing);
+    error = clEnqueueNDRangeKernel(device.cmd_queue, kernel, 1, nullptr, &global_ws, &local_ws, 0, nullptr, nullptr); cl->checkError(error);
+    strategy.transfer(mem_size, events, timing);
+    if (flush_each)
+      clFinish(device.cmd_queue);
+  }
+  clFinish(device.cmd_queue);
+
+  double ms = elapsedMs(beg, HostClock::now());
+  return ms > 0.0 ? options.iterations * 1000.0 / ms : 0.0;
+}
+
+void runGlSyncComparison(ClContext* cl, const ClDevice& device, cl_kernel kernel, const BenchOptions& options, BenchReport& report) {
+  size_t n_modes = sizeof(sync_modes) / sizeof(sync_modes[0]);
+
+  for (size_t s = 0; s < options.sizes.size(); s++){
+    size_t mem_size = options.sizes[s];
+    double base_latency = 0.0, base_throughput = 0.0;
+
+    for (size_t m = 0; m < n_modes; m++){
+      TransferStrategy* strategy = createTransferStrategy(sync_modes[m]);
+      if (!strategy->create(cl, device, mem_size, options.seed, options.fill_mapped)){
+        std::cout << "Skipping " << sync_modes[m] << " on " << device.features.device_name << std::endl;
+        strategy->release();
+        delete strategy;
+        if (m == 0)
+          break;
+        continue;
+      }
+
+      SampleStats latency;
+      BenchRecord record = runTransferBenchmark(cl, device, kernel, options, *strategy, mem_size, options.local_ws, nullptr, &latency);
+      double throughput = measureThroughput(cl, device, kernel, options, *strategy, mem_size, m == 0);
+      strategy->release();
+      delete strategy;
+
+      if (m == 0){
+        base_latency = latency.median;
+        base_throughput = throughput;
+      }
+      std::cout << "Sync " << sync_modes[m] << ": " << throughput << " iterations/s back to back\n";
+
+      record.set("gl_sync", sync_modes[m]);
+      record.set("throughput_iterations_per_sec", throughput);
+      record.set("throughput_bandwidth_gbs", bandwidthGBs(2.0 * mem_size * sizeof(cl_float4), throughput > 0.0 ? 1000.0 / throughput : 0.0));
+      record.set("latency_delta_ms", latency.median - base_latency);
+      record.set("throughput_speedup", base_throughput > 0.0 ? throughput / base_throughput : 0.0);
+      report.add(record);
+    }
+  }
+}
@@ -0,0 +1,17 @@
+#ifndef __GL_SYNC_BENCHMARK_H__
+#define __GL_SYNC_BENCHMARK_H__
+
+#include "ClContext.h"
+#include "BenchOptions.h"
+#include "BenchReport.h"
+
+// Compares the GL-CL synchronization of the interop path for every size:
+//   gl           glFinish before the acquire and clFinish after the release (full flush)
+//   gl_fence     the acquire waits for a GL fence (glFenceSync + clCreateEventFromGLsyncKHR)
+//   gl_implicit  cl_khr_gl_event makes the acquire wait for GL by itself
+// Latency is the usual per-iteration run, throughput runs the iterations back to back: the full flush
+// path still drains GL and CL every iteration, the others only once at the end.
+// Strategies the device cannot run are skipped, the deltas are relative to gl.
+void runGlSyncComparison(ClContext* cl, const ClDevice& device, cl_kernel kernel, const BenchOptions& options, BenchReport& report);
+
+#endif
@@ -0,0 +1,209 @@
+#include "HostBufferPool.h"
+
+// STD
+#include <iostream>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <sys/mman.h>
+  #include <unistd.h>
+#endif
+
+static const size_t huge_page_size = 2 * 1024 * 1024;
+
+static size_t pageSize() {
+#ifdef _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwPageSize;
+#else
+  return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+static size_t roundUp(size_t bytes, size_t alignment) {
+  return (bytes + alignment - 1) / alignment * alignment;
+}
+
+HostBufferPoolStats::HostBufferPoolStats() :
+  hits(0), misses(0), blocks(0), bytes_resident(0), bytes_in_use(0), peak_bytes_resident(0), huge_page_blocks(0), locked_blocks(0) {
+}
+
+HostBufferPool* HostBufferPool::getSingletonPtr() {
+  static HostBufferPool pool;
+  return &pool;
+}
+
+HostBufferPool::HostBufferPool() : m_huge_pages(false), m_lock(false) {
+}
+
+HostBufferPool::~HostBufferPool() {
+  trim();
+  // blocks still in use belong to objects destroyed after the pool, e.g. at exit.
+  for (std::map<void*, Block>::const_iterator it = m_in_use.begin(); it != m_in_use.end(); ++it)
+    free(it->second);
+}
+
+bool HostBufferPool::allocate(size_t bytes, Block& block) {
+  block.ptr = nullptr;
+  block.huge = false;
+  block.locked = false;
+
+#ifdef _WIN32
+  if (m_huge_pages && GetLargePageMinimum() > 0){
+    // needs SeLockMemoryPrivilege, large pages are always locked.
+    block.bytes = roundUp(bytes, GetLargePageMinimum());
+    block.ptr = VirtualAlloc(nullptr, block.bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    block.huge = block.locked = block.ptr != nullptr;
+  }
+  if (!block.ptr){
+    block.bytes = roundUp(bytes, pageSize());
+    block.ptr = VirtualAlloc(nullptr, block.bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+  }
+  if (!block.ptr)
+    return false;
+  if (m_lock && !block.locked){
+    block.locked = VirtualLock(block.ptr, block.bytes) != 0;
+    if (!block.locked)
+      std::cerr << "Host buffer pool: cannot lock " << block.bytes << " bytes, raise the working set size.\n";
+  }
+#else
+  if (m_huge_pages){
+  #ifdef MAP_HUGETLB
+    // explicit huge pages have to be reserved, e.g. in /proc/sys/vm/nr_hugepages.
+    block.bytes = roundUp(bytes, huge_page_size);
+    block.ptr = mmap(nullptr, block.bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (block.ptr == MAP_FAILED)
+      block.ptr = nullptr;
+    block.huge = block.ptr != nullptr;
+  #endif
+  }
+  if (!block.ptr){
+    block.bytes = roundUp(bytes, m_huge_pages ? huge_page_size : pageSize());
+    block.ptr = mmap(nullptr, block.bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (block.ptr == MAP_FAILED){
+      block.ptr = nullptr;
+      return false;
+    }
+  #ifdef MADV_HUGEPAGE
+    // transparent huge pages as the fallback
+    if (m_huge_pages)
+      block.huge = madvise(block.ptr, block.bytes, MADV_HUGEPAGE) == 0;
+  #endif
+  }
+  if (m_lock){
+    block.locked = mlock(block.ptr, block.bytes) == 0;
+    if (!block.locked)
+      std::cerr << "Host buffer pool: cannot mlock " << block.bytes << " bytes, see ulimit -l.\n";
+  }
+#endif
+
+  // fault every page in now instead of during the first measured iteration.
+  size_t step = pageSize();
+  for (size_t offset = 0; offset < block.bytes; offset += step)
+    static_cast<volatile char*>(block.ptr)[offset] = 0;
+  return true;
+}
+
+void HostBufferPool::free(const Block& block) {
+#ifdef _WIN32
+  if (block.locked && !block.huge)
+    VirtualUnlock(block.ptr, block.bytes);
+  VirtualFree(block.ptr, 0, MEM_RELEASE);
+#else
+  if (block.locked)
+    munlock(block.ptr, block.bytes);
+  munmap(block.ptr, block.bytes);
+#endif
+}
+
+void* HostBufferPool::acquire(size_t bytes) {
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+
+  Block block;
+  std::multimap<size_t, Block>::iterator fit = m_free.lower_bound(bytes);
+  if (fit != m_free.end()){
+    block = fit->second;
+    m_free.erase(fit);
+    m_stats.hits++;
+  }
+  else {
+    if (!allocate(bytes, block))
+      return nullptr;
+    m_stats.misses++;
+    m_stats.blocks++;
+    m_stats.bytes_resident += block.bytes;
+    if (m_stats.bytes_resident > m_stats.peak_bytes_resident)
+      m_stats.peak_bytes_resident = m_stats.bytes_resident;
+    if (block.huge)
+      m_stats.huge_page_blocks++;
+    if (block.locked)
+      m_stats.locked_blocks++;
+  }
+
+  m_stats.bytes_in_use += block.bytes;
+  m_in_use[block.ptr] = block;
+  return block.ptr;
+}
+
+void HostBufferPool::release(void* ptr) {
+  if (!ptr)
+    return;
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+
+  std::map<void*, Block>::iterator it = m_in_use.find(ptr);
+  if (it == m_in_use.end()){
+    std::cerr << "Host buffer pool: releasing unknown block " << ptr << std::endl;
+    return;
+  }
+  m_stats.bytes_in_use -= it->second.bytes;
+  m_free.insert(std::make_pair(it->second.bytes, it->second));
+  m_in_use.erase(it);
+}
+
+void HostBufferPool::trim() {
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+
+  for (std::multimap<size_t, Block>::const_iterator it = m_free.begin(); it != m_free.end(); ++it){
+    const Block& block = it->second;
+    m_stats.blocks--;
+    m_stats.bytes_resident -= block.bytes;
+    if (block.huge)
+      m_stats.huge_page_blocks--;
+    if (block.locked)
+      m_stats.locked_blocks--;
+    free(block);
+  }
+  m_free.clear();
+}
+
+HostBufferPoolStats HostBufferPool::stats() const {
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  return m_stats;
+}
+
+BenchRecord HostBufferPool::toRecord() const {
+  HostBufferPoolStats pool_stats = stats();
+  BenchRecord record;
+  record.set("host_buffer_pool", true);
+  record.set("hits", pool_stats.hits);
+  record.set("misses", pool_stats.misses);
+  record.set("blocks", pool_stats.blocks);
+  record.set("bytes_resident", pool_stats.bytes_resident);
+  record.set("bytes_in_use", pool_stats.bytes_in_use);
+  record.set("peak_bytes_resident", pool_stats.peak_bytes_resident);
+  record.set("huge_page_blocks", pool_stats.huge_page_blocks);
+  record.set("locked_blocks", pool_stats.locked_blocks);
+  record.set("huge_pages_requested", m_huge_pages);
+  record.set("lock_requested", m_lock);
+  return record;
+}
+
+void HostBufferPool::printReport() const {
+  HostBufferPoolStats pool_stats = stats();
+  std::cout << "Host buffer pool: " << pool_stats.hits << " hits, " << pool_stats.misses << " misses, "
+            << pool_stats.blocks << " blocks, " << pool_stats.bytes_resident / (1024 * 1024) << " MiB resident (peak "
+            << pool_stats.peak_bytes_resident / (1024 * 1024) << " MiB), " << pool_stats.huge_page_blocks << " on huge pages, "
+            << pool_stats.locked_blocks << " locked\n";
+}
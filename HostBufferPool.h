@@ -0,0 +1,72 @@
+#ifndef __HOST_BUFFER_POOL_H__
+#define __HOST_BUFFER_POOL_H__
+
+// STD
+#include <map>
+
+// BOOST
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/lock_guard.hpp>
+
+#include "BenchReport.h"
+
+struct HostBufferPoolStats {
+  size_t  hits;             // acquires served from a free block
+  size_t  misses;           // acquires that had to allocate
+  size_t  blocks;
+  size_t  bytes_resident;   // allocated and touched, in use or free
+  size_t  bytes_in_use;
+  size_t  peak_bytes_resident;
+  size_t  huge_page_blocks;
+  size_t  locked_blocks;
+
+  HostBufferPoolStats();
+};
+
+// Page aligned host staging memory, kept resident and reused across iterations, sizes and strategies,
+// so neither the allocation nor the first touch of the pages shows up in a measurement.
+// A released block goes back to the pool and serves the next acquire it is large enough for.
+// Blocks are optionally backed by huge pages (explicit, transparent as a fallback) and mlock'd.
+class HostBufferPool {
+public:
+  static HostBufferPool* getSingletonPtr();
+
+  // applies to blocks allocated afterwards.
+  void setHugePages(bool huge_pages) { m_huge_pages = huge_pages; }
+  void setLock(bool lock) { m_lock = lock; }
+
+  // Returns a page aligned block of at least bytes, with its pages already faulted in.
+  // nullptr if the allocation fails.
+  void* acquire(size_t bytes);
+  void release(void* ptr);
+
+  // frees every block that is not in use.
+  void trim();
+
+  HostBufferPoolStats stats() const;
+  BenchRecord toRecord() const;
+  void printReport() const;
+
+private:
+  struct Block {
+    void*   ptr;
+    size_t  bytes;
+    bool    huge;
+    bool    locked;
+  };
+
+  HostBufferPool();
+  ~HostBufferPool();
+
+  bool allocate(size_t bytes, Block& block);
+  void free(const Block& block);
+
+  std::multimap<size_t, Block>  m_free;     // by size, for the best fit
+  std::map<void*, Block>        m_in_use;
+  HostBufferPoolStats           m_stats;
+  bool                          m_huge_pages;
+  bool                          m_lock;
+  mutable boost::mutex          m_mutex;
+};
+
+#endif
@@ -0,0 +1,82 @@
+#include "InputGenerator.h"
+
+// STD
+#include <algorithm>
+
+// BOOST
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+
+static const cl_uint philox_m0 = 0xD2511F53u;
+static const cl_uint philox_m1 = 0xCD9E8D57u;
+static const cl_uint philox_w0 = 0x9E3779B9u;
+static const cl_uint philox_w1 = 0xBB67AE85u;
+
+// below this many elements per thread the threads cost more than they save.
+static const size_t min_elements_per_thread = 64 * 1024;
+
+void philox4x32(const cl_uint counter[4], const cl_uint key[2], cl_uint out[4]) {
+  cl_uint c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+  cl_uint k0 = key[0], k1 = key[1];
+
+  // fixed trip count and no branches, the compiler can vectorize the calling loop.
+  for (int round = 0; round < 10; round++){
+    cl_ulong p0 = static_cast<cl_ulong>(philox_m0) * c0;
+    cl_ulong p1 = static_cast<cl_ulong>(philox_m1) * c2;
+    cl_uint n0 = static_cast<cl_uint>(p1 >> 32) ^ c1 ^ k0;
+    cl_uint n2 = static_cast<cl_uint>(p0 >> 32) ^ c3 ^ k1;
+    c1 = static_cast<cl_uint>(p1);
+    c3 = static_cast<cl_uint>(p0);
+    c0 = n0;
+    c2 = n2;
+    k0 += philox_w0;
+    k1 += philox_w1;
+  }
+
+  out[0] = c0;
+  out[1] = c1;
+  out[2] = c2;
+  out[3] = c3;
+}
+
+// the upper 24 bits as a float in [0, 1), exact.
+static inline float toUnitFloat(cl_uint x) {
+  return (x >> 8) * (1.0f / 16777216.0f);
+}
+
+void generateInput(cl_float4* dst, size_t count, unsigned long long seed, size_t first) {
+  cl_uint key[2] = { static_cast<cl_uint>(seed), static_cast<cl_uint>(seed >> 32) };
+  for (size_t i = 0; i < count; i++){
+    unsigned long long idx = first + i;
+    cl_uint counter[4] = { static_cast<cl_uint>(idx), static_cast<cl_uint>(idx >> 32), 0, 0 };
+    cl_uint r[4];
+    philox4x32(counter, key, r);
+    dst[i].s[0] = toUnitFloat(r[0]);
+    dst[i].s[1] = toUnitFloat(r[1]);
+    dst[i].s[2] = toUnitFloat(r[2]);
+    dst[i].s[3] = 1.0f;
+  }
+}
+
+void generateInputParallel(cl_float4* dst, size_t count, unsigned long long seed, unsigned int num_threads) {
+  if (num_threads == 0)
+    num_threads = std::max(1u, boost::thread::hardware_concurrency());
+  size_t max_threads = std::max<size_t>(1, count / min_elements_per_thread);
+  if (num_threads > max_threads)
+    num_threads = static_cast<unsigned int>(max_threads);
+
+  if (num_threads == 1){
+    generateInput(dst, count, seed);
+    return;
+  }
+
+  size_t chunk = (count + num_threads - 1) / num_threads;
+  boost::thread_group threads;
+  for (unsigned int t = 0; t < num_threads; t++){
+    size_t first = std::min(count, t * chunk);
+    size_t n = std::min(chunk, count - first);
+    if (n > 0)
+      threads.create_thread(boost::bind(generateInput, dst + first, n, seed, first));
+  }
+  threads.join_all();
+}
@@ -0,0 +1,21 @@
+#ifndef __INPUT_GENERATOR_H__
+#define __INPUT_GENERATOR_H__
+
+#include "ClContext.h"
+
+// Seeded input data from the counter based Philox4x32-10 generator (Salmon et al., SC'11).
+// Element i depends only on the seed and i, so the data is bit-reproducible for a seed on every
+// platform and for every split into chunks and threads.
+
+const unsigned long long default_input_seed = 1;
+
+// Philox4x32-10 of one counter.
+void philox4x32(const cl_uint counter[4], const cl_uint key[2], cl_uint out[4]);
+
+// Fills count elements: x, y and z uniform in [0, 1), w = 1. dst[0] is element first of the sequence.
+void generateInput(cl_float4* dst, size_t count, unsigned long long seed, size_t first = 0);
+
+// generateInput split across num_threads threads, 0 for one per core.
+void generateInputParallel(cl_float4* dst, size_t count, unsigned long long seed, unsigned int num_threads = 0);
+
+#endif
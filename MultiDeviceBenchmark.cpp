@@ -0,0 +1,239 @@
+#include "MultiDeviceBenchmark.h"
+#include "Benchmark.h"
+#include "ClProfiling.h"
+#include "ClMemPool.h"
+#include "GlBackend.h"
+
+// STD
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+
+// BOOST
+#include <boost/thread.hpp>
+#include <boost/thread/barrier.hpp>
+#include <boost/bind.hpp>
+
+// Work of one device in a multi-device run.
+struct DeviceRun {
+  const ClDevice*   device;
+  cl_kernel         kernel;
+  TransferStrategy* strategy;
+  size_t            mem_size;
+  SampleStats       stats;
+  BenchRecord       record;
+
+  DeviceRun() : device(nullptr), kernel(0), strategy(nullptr), mem_size(0) {}
+};
+
+// GL strategies run with the GL context of their device current on the calling thread,
+// which has to release it before another thread can take it.
+static void bindGl(const DeviceRun& run) {
+  if (run.strategy->needsGl())
+    run.device->gl->makeCurrent();
+}
+
+static void unbindGl(const DeviceRun& run) {
+  if (run.strategy->needsGl())
+    run.device->gl->doneCurrent();
+}
+
+// Why mode cannot run on all devices at once, empty if it can: a GL strategy needs a GL context
+// of its own for every device, a context is current on one thread at a time.
+static std::string glConflict(ClContext* cl, const std::vector<int>& device_indices, const std::string& mode) {
+  if (!transferStrategyNeedsGl(mode))
+    return "";
+  for (size_t d = 0; d < device_indices.size(); d++){
+    const ClDevice& device = cl->devices[device_indices[d]];
+    if (!device.gl)
+      return device.features.device_name + " shares no GL context";
+    for (size_t o = 0; o < d; o++){
+      if (cl->devices[device_indices[o]].gl == device.gl)
+        return device.features.device_name + " and " + cl->devices[device_indices[o]].features.device_name + " share the " + device.gl->description() + " context";
+    }
+  }
+  return "";
+}
+
+static void concurrentWorker(ClContext* cl, const BenchOptions* options, DeviceRun* run, boost::barrier* start) {
+  bindGl(*run);
+  start->wait();
+  run->record = runTransferBenchmark(cl, *run->device, run->kernel, *options, *run->strategy, run->mem_size, options->local_ws, nullptr, &run->stats);
+  unbindGl(*run);
+}
+
+// Every iteration starts and ends on the barrier, so the main thread can time the slowest device.
+static void splitWorker(ClContext* cl, const BenchOptions* options, DeviceRun* run, boost::barrier* sync, int n_runs) {
+  bindGl(*run);
+  if (run->mem_size > 0)
+    setTransferKernelArgs(run->kernel, *run->strategy, run->mem_size, options->local_ws);
+
+  for (int i = 0; i < n_runs; i++){
+    sync->wait();
+    if (run->mem_size > 0){
+      IterationTiming timing;
+      runTransferIteration(cl, *run->device, run->kernel, *run->strategy, run->mem_size, options->local_ws, timing);
+    }
+    sync->wait();
+  }
+  unbindGl(*run);
+}
+
+// the GL context a GL strategy ran on and whether it renders on the device itself.
+static void setGlRecord(BenchRecord& record, const ClDevice& device, bool use_gl) {
+  if (!use_gl)
+    return;
+  record.set("gl_context", device.gl->description());
+  record.set("gl_current_device", device.gl_current_device);
+}
+
+static double runBandwidth(const DeviceRun& run) {
+  return bandwidthGBs(2.0 * run.mem_size * sizeof(cl_float4), run.stats.median);
+}
+
+void runMultiDevice(ClContext* cl, const std::vector<int>& device_indices, const std::vector<cl_kernel>& kernels,
+                    const BenchOptions& options, BenchReport& report) {
+  size_t n_devices = device_indices.size();
+
+  for (size_t m = 0; m < options.modes.size(); m++){
+    const std::string& mode = options.modes[m];
+    std::string gl_conflict = glConflict(cl, device_indices, mode);
+    if (!gl_conflict.empty()){
+      std::cout << "Skipping " << mode << ": " << gl_conflict << ".\n";
+      continue;
+    }
+    bool use_gl = transferStrategyNeedsGl(mode);
+
+    // devices rendering their own GL context have an interop path of their own.
+    int own_gl_paths = 0;
+    for (size_t d = 0; d < n_devices && use_gl; d++){
+      if (cl->devices[device_indices[d]].gl_current_device)
+        own_gl_paths++;
+    }
+
+    for (size_t s = 0; s < options.sizes.size(); s++){
+      size_t mem_size = options.sizes[s];
+
+      std::vector<DeviceRun> runs(n_devices);
+      bool created = true;
+      for (size_t d = 0; d < n_devices; d++){
+        runs[d].device = &cl->devices[device_indices[d]];
+        runs[d].kernel = kernels[d];
+        runs[d].mem_size = mem_size;
+        runs[d].strategy = createTransferStrategy(mode);
+        bindGl(runs[d]);
+        created = runs[d].strategy->create(cl, *runs[d].device, mem_size, options.seed, options.fill_mapped) && created;
+        unbindGl(runs[d]);
+      }
+
+      if (created){
+        //===============================
+        // solo: one device at a time
+        //===============================
+        std::vector<double> solo_bandwidth(n_devices);
+        double solo_sum = 0.0, solo_best = 0.0;
+        for (size_t d = 0; d < n_devices; d++){
+          bindGl(runs[d]);
+          BenchRecord record = runTransferBenchmark(cl, *runs[d].device, runs[d].kernel, options, *runs[d].strategy, mem_size, options.local_ws, nullptr, &runs[d].stats);
+          unbindGl(runs[d]);
+          solo_bandwidth[d] = runBandwidth(runs[d]);
+          solo_sum += solo_bandwidth[d];
+          solo_best = std::max(solo_best, solo_bandwidth[d]);
+          record.set("phase", "solo");
+          setGlRecord(record, *runs[d].device, use_gl);
+          report.add(record);
+        }
+
+        //===============================
+        // concurrent: all devices at once, one host thread each
+        //===============================
+        boost::barrier start(static_cast<unsigned int>(n_devices));
+        boost::thread_group threads;
+        for (size_t d = 0; d < n_devices; d++)
+          threads.create_thread(boost::bind(concurrentWorker, cl, &options, &runs[d], &start));
+        threads.join_all();
+
+        double concurrent_sum = 0.0;
+        for (size_t d = 0; d < n_devices; d++){
+          double bandwidth = runBandwidth(runs[d]);
+          concurrent_sum += bandwidth;
+          runs[d].record.set("phase", "concurrent");
+          runs[d].record.set("contention", solo_bandwidth[d] > 0.0 ? bandwidth / solo_bandwidth[d] : 0.0);
+          setGlRecord(runs[d].record, *runs[d].device, use_gl);
+          report.add(runs[d].record);
+        }
+
+        BenchRecord aggregate;
+        aggregate.set("phase", "concurrent_aggregate");
+        aggregate.set("mode", mode);
+        aggregate.set("devices", n_devices);
+        aggregate.set("elements", mem_size);
+        aggregate.set("aggregate_bandwidth_gbs", concurrent_sum);
+        aggregate.set("solo_sum_bandwidth_gbs", solo_sum);
+        aggregate.set("scaling_efficiency", solo_sum > 0.0 ? concurrent_sum / solo_sum : 0.0);
+        if (use_gl){
+          aggregate.set("gl_contexts", n_devices);
+          aggregate.set("own_gl_paths", own_gl_paths);
+        }
+        report.add(aggregate);
+        std::cout << "Aggregate bandwidth = " << concurrent_sum << " GB/s (" << solo_sum << " GB/s solo sum)\n";
+
+        //===============================
+        // split: one logical buffer, shares proportional to the solo bandwidth
+        //===============================
+        if (options.split && solo_sum > 0.0){
+          std::ostringstream shares;
+          size_t assigned = 0;
+          for (size_t d = 0; d < n_devices; d++){
+            size_t share = (d + 1 == n_devices) ? mem_size - assigned
+                                                : static_cast<size_t>(mem_size * (solo_bandwidth[d] / solo_sum));
+            runs[d].mem_size = share;
+            assigned += share;
+            shares << (d ? "," : "") << share;
+          }
+
+          int n_runs = options.warmup + options.iterations;
+          boost::barrier sync(static_cast<unsigned int>(n_devices + 1));
+          boost::thread_group split_threads;
+          for (size_t d = 0; d < n_devices; d++)
+            split_threads.create_thread(boost::bind(splitWorker, cl, &options, &runs[d], &sync, n_runs));
+
+          std::vector<double> makespan;
+          for (int i = 0; i < n_runs; i++){
+            sync.wait();
+            HostClock::time_point beg = HostClock::now();
+            sync.wait();
+            if (i >= options.warmup)
+              makespan.push_back(elapsedMs(beg, HostClock::now()));
+          }
+          split_threads.join_all();
+
+          SampleStats stats = computeStats(makespan);
+          double bandwidth = bandwidthGBs(2.0 * mem_size * sizeof(cl_float4), stats.median);
+
+          BenchRecord split;
+          split.set("phase", "split");
+          split.set("mode", mode);
+          split.set("devices", n_devices);
+          split.set("elements", mem_size);
+          split.set("shares", shares.str());
+          setStats(split, "", "_ms", stats);
+          split.set("bandwidth_gbs", bandwidth);
+          split.set("speedup_vs_best_device", solo_best > 0.0 ? bandwidth / solo_best : 0.0);
+          report.add(split);
+          std::cout << "Split (" << shares.str() << ") = " << bandwidth << " GB/s\n";
+        }
+      }
+
+      for (size_t d = 0; d < n_devices; d++){
+        bindGl(runs[d]);
+        runs[d].strategy->release();
+        unbindGl(runs[d]);
+        delete runs[d].strategy;
+        // the bins of this size would not fit the next one, the idle pools give them back to the arenas.
+        if (cl->getMemPool(*runs[d].device))
+          cl->getMemPool(*runs[d].device)->defragment();
+      }
+    }
+  }
+}
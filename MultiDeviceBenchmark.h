@@ -0,0 +1,21 @@
+#ifndef __MULTI_DEVICE_BENCHMARK_H__
+#define __MULTI_DEVICE_BENCHMARK_H__
+
+// STD
+#include <vector>
+
+#include "ClContext.h"
+#include "BenchOptions.h"
+#include "BenchReport.h"
+
+// Runs the copy workload on every device in device_indices, first one device at a time and
+// then on all of them at once from separate host threads. Reports per-device and aggregate
+// bandwidth and the concurrent / solo bandwidth ratio (bus contention).
+// With options.split, one logical buffer of every size is also split across the devices
+// proportional to their solo bandwidth and processed in lockstep.
+// kernels[i] belongs to devices[device_indices[i]]. GL strategies run only if every device is bound to
+// a GL context of its own (ClDevice::gl), each thread drives the context of its device.
+void runMultiDevice(ClContext* cl, const std::vector<int>& device_indices, const std::vector<cl_kernel>& kernels,
+                    const BenchOptions& options, BenchReport& report);
+
+#endif
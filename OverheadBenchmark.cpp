@@ -0,0 +1,233 @@
+#include <GL/glew.h>
+
+#include "OverheadBenchmark.h"
+#include "ClProfiling.h"
+#include "BenchStats.h"
+
+// STD
+#include <iostream>
+#include <vector>
+
+// BOOST
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+// clSetKernelArg is too short for the host clock, one sample is the mean of this many calls.
+static const int set_arg_batch = 64;
+
+// transfer sizes of the read, write and map tests in bytes
+static const size_t small_sizes[] = { 4, 16, 64, 256, 1024, 4096, 16384, 65536 };
+
+static double elapsedUs(const HostClock::time_point& beg, const HostClock::time_point& end) {
+  return elapsedMs(beg, end) * 1000.0;
+}
+
+// Signalled by the CL_COMPLETE callback of a user event.
+struct CallbackSignal {
+  boost::mutex              mutex;
+  boost::condition_variable cond;
+  bool                      done;
+
+  CallbackSignal() : done(false) {}
+};
+
+static void CL_CALLBACK onComplete(cl_event event, cl_int status, void* user_data) {
+  CallbackSignal* signal = static_cast<CallbackSignal*>(user_data);
+  boost::mutex::scoped_lock lock(signal->mutex);
+  signal->done = true;
+  signal->cond.notify_one();
+}
+
+static void addRecord(const ClDevice& device, const std::string& test, size_t bytes, size_t calls,
+                      const std::vector<double>& samples, BenchReport& report) {
+  SampleStats stats = computeStats(samples);
+
+  BenchRecord record;
+  record.set("device", device.features.device_name);
+  record.set("platform", device.features.platform_name);
+  record.set("driver_version", device.features.driver_version);
+  record.set("mode", "overhead");
+  record.set("test", test);
+  if (bytes > 0)
+    record.set("bytes", bytes);
+  record.set("calls_per_sample", calls);
+  record.set("samples", samples.size());
+  setStats(record, "", "_us", stats);
+  report.add(record);
+
+  std::cout << test;
+  if (bytes > 0)
+    std::cout << " " << bytes << " B";
+  std::cout << ": median = " << stats.median << " us, p99 = " << stats.p99 << " us, max = " << stats.max << " us\n";
+}
+
+void runOverheadSuite(ClContext* cl, const ClDevice& device, cl_kernel kernel, const BenchOptions& options, BenchReport& report) {
+  cl_int error;
+  cl_command_queue queue = device.cmd_queue;
+  int warmup = options.warmup;
+  int n_samples = options.overhead_samples;
+  std::vector<double> samples;
+  std::cout << "Device: " << device.features.device_name << ", driver: " << device.features.driver_version
+            << ", overhead samples: " << n_samples << std::endl;
+
+  //===============================
+  // kernel launches
+  //===============================
+  cl_kernel empty_kernel = cl->createKernel(options.kernel_file, "emptyKernel", device);
+  if (empty_kernel){
+    size_t global_ws = 1;
+    for (int i = 0; i < warmup + n_samples; i++){
+      HostClock::time_point beg = HostClock::now();
+      error = clEnqueueNDRangeKernel(queue, empty_kernel, 1, nullptr, &global_ws, nullptr, 0, nullptr, nullptr); cl->checkError(error);
+      clFinish(queue);
+      if (i >= warmup)
+        samples.push_back(elapsedUs(beg, HostClock::now()));
+    }
+    addRecord(device, "launch", 0, 1, samples, report);
+
+    samples.clear();
+    for (int i = 0; i < warmup + n_samples; i++){
+      HostClock::time_point beg = HostClock::now();
+      error = clEnqueueNDRangeKernel(queue, empty_kernel, 1, nullptr, &global_ws, nullptr, 0, nullptr, nullptr); cl->checkError(error);
+      HostClock::time_point end = HostClock::now();
+      clFinish(queue);
+      if (i >= warmup)
+        samples.push_back(elapsedUs(beg, end));
+    }
+    addRecord(device, "enqueue", 0, 1, samples, report);
+    clReleaseKernel(empty_kernel);
+  }
+  else
+    std::cout << "Skipping launch and enqueue: no emptyKernel in " << options.kernel_file << std::endl;
+
+  samples.clear();
+  for (int i = 0; i < warmup + n_samples; i++){
+    cl_int count = i;
+    HostClock::time_point beg = HostClock::now();
+    for (int c = 0; c < set_arg_batch; c++)
+      clSetKernelArg(kernel, 2, sizeof(cl_int), &count);
+    if (i >= warmup)
+      samples.push_back(elapsedUs(beg, HostClock::now()) / set_arg_batch);
+  }
+  addRecord(device, "set_arg", 0, set_arg_batch, samples, report);
+
+  //===============================
+  // synchronization
+  //===============================
+  samples.clear();
+  clFinish(queue);
+  for (int i = 0; i < warmup + n_samples; i++){
+    HostClock::time_point beg = HostClock::now();
+    clFinish(queue);
+    if (i >= warmup)
+      samples.push_back(elapsedUs(beg, HostClock::now()));
+  }
+  addRecord(device, "finish", 0, 1, samples, report);
+
+  samples.clear();
+  for (int i = 0; i < warmup + n_samples; i++){
+    cl_event event = clCreateUserEvent(device.ctx, &error); cl->checkError(error);
+    if (error != CL_SUCCESS)
+      break;
+    CallbackSignal signal;
+    error = clSetEventCallback(event, CL_COMPLETE, onComplete, &signal); cl->checkError(error);
+    if (error != CL_SUCCESS){
+      clReleaseEvent(event);
+      break;
+    }
+    HostClock::time_point beg = HostClock::now();
+    clSetUserEventStatus(event, CL_COMPLETE);
+    {
+      boost::mutex::scoped_lock lock(signal.mutex);
+      while (!signal.done)
+        signal.cond.wait(lock);
+    }
+    HostClock::time_point end = HostClock::now();
+    clReleaseEvent(event);
+    if (i >= warmup)
+      samples.push_back(elapsedUs(beg, end));
+  }
+  if (!samples.empty())
+    addRecord(device, "event_callback", 0, 1, samples, report);
+
+  //===============================
+  // GL objects
+  //===============================
+  if (device.gl && device.features.has_cl_khr_gl_sharing){
+    GLuint gl_buffer;
+    glGenBuffers(1, &gl_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, gl_buffer);
+    glBufferData(GL_ARRAY_BUFFER, small_sizes[0], nullptr, GL_STATIC_DRAW);
+    glFinish();
+    cl_mem shared = clCreateFromGLBuffer(device.ctx, CL_MEM_READ_WRITE, gl_buffer, &error); cl->checkError(error);
+    if (error == CL_SUCCESS){
+      samples.clear();
+      for (int i = 0; i < warmup + n_samples; i++){
+        HostClock::time_point beg = HostClock::now();
+        error = clEnqueueAcquireGLObjects(queue, 1, &shared, 0, nullptr, nullptr); cl->checkError(error);
+        error = clEnqueueReleaseGLObjects(queue, 1, &shared, 0, nullptr, nullptr); cl->checkError(error);
+        clFinish(queue);
+        if (i >= warmup)
+          samples.push_back(elapsedUs(beg, HostClock::now()));
+      }
+      addRecord(device, "acquire_release", 0, 1, samples, report);
+      clReleaseMemObject(shared);
+    }
+    glDeleteBuffers(1, &gl_buffer);
+  }
+  else
+    std::cout << "Skipping acquire_release: the device shares no GL context\n";
+
+  //===============================
+  // small transfers
+  //===============================
+  size_t n_sizes = sizeof(small_sizes) / sizeof(small_sizes[0]);
+  size_t max_bytes = small_sizes[n_sizes - 1];
+  std::vector<unsigned char> host(max_bytes);
+  cl_mem buffer = clCreateBuffer(device.ctx, CL_MEM_READ_WRITE, max_bytes, nullptr, &error); cl->checkError(error);
+  cl_mem mapped = clCreateBuffer(device.ctx, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, max_bytes, nullptr, &error); cl->checkError(error);
+  if (!buffer || !mapped){
+    if (buffer) clReleaseMemObject(buffer);
+    if (mapped) clReleaseMemObject(mapped);
+    return;
+  }
+
+  for (size_t s = 0; s < n_sizes; s++){
+    size_t bytes = small_sizes[s];
+
+    samples.clear();
+    for (int i = 0; i < warmup + n_samples; i++){
+      HostClock::time_point beg = HostClock::now();
+      error = clEnqueueReadBuffer(queue, buffer, CL_TRUE, 0, bytes, &host[0], 0, nullptr, nullptr); cl->checkError(error);
+      if (i >= warmup)
+        samples.push_back(elapsedUs(beg, HostClock::now()));
+    }
+    addRecord(device, "read", bytes, 1, samples, report);
+
+    samples.clear();
+    for (int i = 0; i < warmup + n_samples; i++){
+      HostClock::time_point beg = HostClock::now();
+      error = clEnqueueWriteBuffer(queue, buffer, CL_TRUE, 0, bytes, &host[0], 0, nullptr, nullptr); cl->checkError(error);
+      if (i >= warmup)
+        samples.push_back(elapsedUs(beg, HostClock::now()));
+    }
+    addRecord(device, "write", bytes, 1, samples, report);
+
+    // the unmap completes with the clFinish, otherwise the next map would wait for it.
+    samples.clear();
+    for (int i = 0; i < warmup + n_samples; i++){
+      HostClock::time_point beg = HostClock::now();
+      void* ptr = clEnqueueMapBuffer(queue, mapped, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, bytes, 0, nullptr, nullptr, &error); cl->checkError(error);
+      if (ptr){
+        error = clEnqueueUnmapMemObject(queue, mapped, ptr, 0, nullptr, nullptr); cl->checkError(error);
+      }
+      clFinish(queue);
+      if (i >= warmup)
+        samples.push_back(elapsedUs(beg, HostClock::now()));
+    }
+    addRecord(device, "map", bytes, 1, samples, report);
+  }
+
+  clReleaseMemObject(buffer);
+  clReleaseMemObject(mapped);
+}
@@ -0,0 +1,19 @@
+#ifndef __OVERHEAD_BENCHMARK_H__
+#define __OVERHEAD_BENCHMARK_H__
+
+#include "ClContext.h"
+#include "BenchOptions.h"
+#include "BenchReport.h"
+
+// Fixed costs of the device and driver, options.overhead_samples samples each, in microseconds:
+//   launch             emptyKernel enqueue up to the end of clFinish
+//   enqueue            the clEnqueueNDRangeKernel call of emptyKernel alone
+//   set_arg            one clSetKernelArg of kernel (mean of a batch of calls per sample)
+//   finish             clFinish of an idle queue
+//   event_callback     clSetUserEventStatus until a CL_COMPLETE callback has woken the waiting thread
+//   acquire_release    acquire and release of a GL buffer and clFinish, if the device shares a GL context
+//   read, write, map   blocking read, blocking write, blocking map and unmap of 4 B to 64 KiB
+// kernel is myKernel, only its arguments are set.
+void runOverheadSuite(ClContext* cl, const ClDevice& device, cl_kernel kernel, const BenchOptions& options, BenchReport& report);
+
+#endif
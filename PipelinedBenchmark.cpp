@@ -0,0 +1,157 @@
+#include "PipelinedBenchmark.h"
+#include "Benchmark.h"
+#include "ClProfiling.h"
+#include "TransferStrategy.h"
+
+// STD
+#include <iostream>
+#include <vector>
+
+// One in-flight frame: a strategy with its own input, output and staging resources, and a command
+// queue of its own. The strategy sees a copy of the device with that queue, so the commands of a
+// frame stay in order while different frames overlap.
+struct PipelineSlot {
+  ClDevice              device;
+  TransferStrategy*     strategy;
+  IterationEvents       events;
+  IterationTiming       timing;
+  HostClock::time_point produce_time;
+
+  PipelineSlot() : strategy(nullptr), events(false) {}
+};
+
+static void releaseSlots(std::vector<PipelineSlot>& slots) {
+  for (size_t s = 0; s < slots.size(); s++){
+    if (slots[s].strategy){
+      slots[s].strategy->release();
+      delete slots[s].strategy;
+      slots[s].strategy = nullptr;
+    }
+    if (slots[s].device.cmd_queue)
+      clReleaseCommandQueue(slots[s].device.cmd_queue);
+    slots[s].device.cmd_queue = 0;
+  }
+}
+
+bool runPipelinedBenchmark(ClContext* cl, const ClDevice& device, cl_kernel mykernel, const BenchOptions& options,
+                           const std::string& mode, size_t mem_size, int depth, BenchRecord& record, PipelineResult* result) {
+  cl_int error = CL_SUCCESS;
+  size_t bytes = mem_size * sizeof(cl_float4);
+
+  std::cout << "Device: " << device.features.device_name << ", mode: " << mode << ", pipeline depth: " << depth
+            << ", elements: " << mem_size << std::endl;
+
+  std::vector<PipelineSlot> slots(depth);
+  for (int s = 0; s < depth; s++){
+    slots[s].device = device;
+    slots[s].device.cmd_queue = cl->createCommandQueue(device, 0);
+    if (!slots[s].device.cmd_queue){
+      std::cerr << "Cannot create the command queue of frame slot " << s << " of " << depth << std::endl;
+      releaseSlots(slots);
+      return false;
+    }
+    slots[s].strategy = createTransferStrategy(mode);
+    if (!slots[s].strategy->create(cl, slots[s].device, mem_size, options.seed, options.fill_mapped)){
+      std::cerr << "Cannot create the " << mode << " transfer strategy of frame slot " << s << " of " << depth << std::endl;
+      releaseSlots(slots);
+      return false;
+    }
+  }
+
+  size_t local_ws = options.local_ws;
+  size_t global_ws = (mem_size + local_ws - 1) / local_ws * local_ws;
+
+  int n_frames = options.warmup + options.iterations;
+  std::vector<double> latencies;
+  double upload_ms = 0.0;
+  HostClock::time_point timed_beg = HostClock::now();
+
+  // Frame f is produced in iteration f and consumed in iteration f + depth - 1,
+  // so a slot is always consumed before it is produced into again.
+  for (int f = 0; f < n_frames + depth - 1 && error == CL_SUCCESS; f++){
+
+    //===============================
+    // produce frame f
+    //===============================
+    if (f < n_frames){
+      PipelineSlot& slot = slots[f % depth];
+      if (f == options.warmup)
+        timed_beg = HostClock::now();
+
+      slot.produce_time = HostClock::now();
+      slot.timing = IterationTiming();
+      // the arguments are captured by the enqueue, the next frame sets its own.
+      setTransferKernelArgs(mykernel, *slot.strategy, mem_size, local_ws);
+      slot.strategy->beforeKernel(slot.events, slot.timing);
+      error = clEnqueueNDRangeKernel(slot.device.cmd_queue, mykernel, 1, nullptr, &global_ws, &local_ws, 0, nullptr, nullptr); cl->checkError(error);
+      clFlush(slot.device.cmd_queue);
+      if (error != CL_SUCCESS)
+        break;
+    }
+
+    //===============================
+    // consume frame f - depth + 1
+    //===============================
+    int consumed = f - depth + 1;
+    if (consumed < 0)
+      continue;
+
+    PipelineSlot& slot = slots[consumed % depth];
+    slot.strategy->transfer(mem_size, slot.events, slot.timing);
+    error = clFinish(slot.device.cmd_queue); cl->checkError(error);
+
+    if (consumed >= options.warmup){
+      upload_ms += slot.timing.upload_ms;
+      latencies.push_back(elapsedMs(slot.produce_time, HostClock::now()));
+    }
+  }
+  double timed_ms = elapsedMs(timed_beg, HostClock::now());
+  releaseSlots(slots);
+  if (error != CL_SUCCESS){
+    std::cerr << "The pipelined " << mode << " loop failed" << std::endl;
+    return false;
+  }
+
+  SampleStats latency = computeStats(latencies);
+  double frames_per_sec = timed_ms > 0.0 ? options.iterations * 1000.0 / timed_ms : 0.0;
+  if (result){
+    result->latency = latency;
+    result->frames_per_sec = frames_per_sec;
+  }
+  double bytes_moved = 2.0 * bytes * options.iterations;
+
+  std::cout << "Throughput = " << frames_per_sec << " frames/s, latency (median) = " << latency.median << " ms" << std::endl;
+
+  record.set("device", device.features.device_name);
+  record.set("platform", device.features.platform_name);
+  record.set("mode", mode);
+  record.set("pipeline_depth", depth);
+  record.set("elements", mem_size);
+  record.set("bytes", bytes);
+  record.set("local_ws", local_ws);
+  record.set("warmup", options.warmup);
+  record.set("iterations", options.iterations);
+  record.set("frames_per_sec", frames_per_sec);
+  record.set("bandwidth_gbs", bandwidthGBs(bytes_moved, timed_ms));
+  record.set("avg_upload_ms", options.iterations > 0 ? upload_ms / options.iterations : 0.0);
+  setStats(record, "latency_", "_ms", latency);
+  return true;
+}
+
+void runPipelineComparison(ClContext* cl, const ClDevice& device, cl_kernel kernel, const BenchOptions& options, BenchReport& report) {
+  for (size_t m = 0; m < options.modes.size(); m++){
+    for (size_t s = 0; s < options.sizes.size(); s++){
+      PipelineResult serial_result, pipelined_result;
+      BenchRecord serial, pipelined;
+      if (!runPipelinedBenchmark(cl, device, kernel, options, options.modes[m], options.sizes[s], 1, serial, &serial_result) ||
+          !runPipelinedBenchmark(cl, device, kernel, options, options.modes[m], options.sizes[s], options.pipeline_depth, pipelined, &pipelined_result))
+        continue;
+
+      // throughput gained and latency paid, relative to the serialised loop.
+      pipelined.set("throughput_speedup", serial_result.frames_per_sec > 0.0 ? pipelined_result.frames_per_sec / serial_result.frames_per_sec : 0.0);
+      pipelined.set("latency_added_ms", pipelined_result.latency.median - serial_result.latency.median);
+      report.add(serial);
+      report.add(pipelined);
+    }
+  }
+}
@@ -0,0 +1,28 @@
+#ifndef __PIPELINED_BENCHMARK_H__
+#define __PIPELINED_BENCHMARK_H__
+
+#include "ClContext.h"
+#include "BenchOptions.h"
+#include "BenchReport.h"
+#include "BenchStats.h"
+
+struct PipelineResult {
+  SampleStats latency;          // produce -> consumed, per frame
+  double      frames_per_sec;   // sustained over the timed frames
+
+  PipelineResult() : frames_per_sec(0.0) {}
+};
+
+// Producer/consumer loop with depth in-flight frames, every frame with a transfer strategy of mode
+// of its own: the kernels of the next frames are queued while frame i is moved to its consumer by
+// the strategy (read back, map, GL upload, ...), the same way as in runTransferBenchmark.
+// There is no clFinish inside the loop. Depth 1 is the serialised loop.
+// false, after printing why, if the strategies cannot be created or a command fails.
+bool runPipelinedBenchmark(ClContext* cl, const ClDevice& device, cl_kernel kernel, const BenchOptions& options,
+                           const std::string& mode, size_t mem_size, int depth, BenchRecord& record,
+                           PipelineResult* result = nullptr);
+
+// Runs depth 1 and options.pipeline_depth for every strategy and size and reports throughput and latency of both.
+void runPipelineComparison(ClContext* cl, const ClDevice& device, cl_kernel kernel, const BenchOptions& options, BenchReport& report);
+
+#endif
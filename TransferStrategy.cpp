@@ -0,0 +1,695 @@
+#include <GL/glew.h>
+
+#include "TransferStrategy.h"
+#include "HostBufferPool.h"
+#include "ClMemPool.h"
+
+// STD
+#include <iostream>
+#include <algorithm>
+#include <deque>
+#include <stdlib.h>
+
+//===============================
+// IterationEvents
+//===============================
+IterationEvents::IterationEvents(bool profile) :
+  profile(profile), acquire(0), kernel(0), read(0), release(0) {
+}
+
+void IterationEvents::collect(IterationTiming& timing) {
+  // strategies with several commands per stage fill the timing themselves.
+  if (acquire)  timing.acquire = takeEventTiming(acquire);
+  if (kernel)   timing.kernel  = takeEventTiming(kernel);
+  if (read)     timing.read    = takeEventTiming(read);
+  if (release)  timing.release = takeEventTiming(release);
+}
+
+//===============================
+// TransferStrategy
+//===============================
+TransferStrategy::TransferStrategy() :
+  cl(nullptr), device(nullptr), device_a(0), device_c(0), gl_buffer_c(0), m_capacity(0) {
+}
+
+TransferStrategy::~TransferStrategy() {
+}
+
+bool TransferStrategy::create(ClContext* cl_context, const ClDevice& cl_device, size_t capacity, unsigned long long seed, bool fill_mapped) {
+  cl = cl_context;
+  device = &cl_device;
+  m_capacity = capacity;
+
+  if (!createInput())
+    return false;
+
+  bool filled = false;
+  if (fill_mapped){
+    void* ptr = mapInput();
+    if (ptr){
+      generateInputParallel(static_cast<cl_float4*>(ptr), capacity, seed);
+      unmapInput(ptr);
+      filled = true;
+    }
+  }
+  else {
+    HostBufferPool* pool = HostBufferPool::getSingletonPtr();
+    cl_float4* host_a = static_cast<cl_float4*>(pool->acquire(capacity * sizeof(cl_float4)));
+    if (host_a){
+      generateInputParallel(host_a, capacity, seed);
+      filled = writeInput(host_a);
+      pool->release(host_a);
+    }
+  }
+
+  return filled && createOutput();
+}
+
+bool TransferStrategy::createInput() {
+  device_a = createDeviceBuffer(m_capacity * sizeof(cl_float4), CL_MEM_READ_ONLY);
+  return device_a != 0;
+}
+
+void* TransferStrategy::mapInput() {
+  cl_int error;
+  void* ptr = clEnqueueMapBuffer(device->cmd_queue, device_a, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, 0, m_capacity * sizeof(cl_float4), 0, nullptr, nullptr, &error); cl->checkError(error);
+  return error == CL_SUCCESS ? ptr : nullptr;
+}
+
+void TransferStrategy::unmapInput(void* ptr) {
+  cl_int error = clEnqueueUnmapMemObject(device->cmd_queue, device_a, ptr, 0, nullptr, nullptr); cl->checkError(error);
+}
+
+bool TransferStrategy::writeInput(const cl_float4* host_a) {
+  cl_int error = clEnqueueWriteBuffer(device->cmd_queue, device_a, CL_TRUE, 0, m_capacity * sizeof(cl_float4), host_a, 0, nullptr, nullptr); cl->checkError(error);
+  return error == CL_SUCCESS;
+}
+
+cl_mem TransferStrategy::createDeviceBuffer(size_t bytes, cl_mem_flags flags) {
+  ClMemPool* pool = cl->getMemPool(*device);
+  if (pool)
+    return pool->allocate(bytes);
+  cl_int error;
+  cl_mem mem = clCreateBuffer(device->ctx, flags, bytes, nullptr, &error); cl->checkError(error);
+  return error == CL_SUCCESS ? mem : 0;
+}
+
+void TransferStrategy::releaseDeviceBuffer(cl_mem& mem) {
+  if (!mem)
+    return;
+  ClMemPool* pool = cl->getMemPool(*device);
+  if (!pool || !pool->release(mem))
+    clReleaseMemObject(mem);
+  mem = 0;
+}
+
+bool TransferStrategy::needsGl() const {
+  return transferStrategyNeedsGl(name());
+}
+
+void TransferStrategy::setKernelArgs(cl_kernel kernel) {
+  clSetKernelArg(kernel, 0, sizeof(cl_mem), &device_a);
+  clSetKernelArg(kernel, 1, sizeof(cl_mem), &device_c);
+}
+
+void TransferStrategy::release() {
+  releaseOutput();
+  releaseInput();
+  releaseDeviceBuffer(device_c);
+  releaseDeviceBuffer(device_a);
+  if (gl_buffer_c)
+    glDeleteBuffers(1, &gl_buffer_c);
+  gl_buffer_c = 0;
+  m_capacity = 0;
+}
+
+bool TransferStrategy::createGlBuffer() {
+  // drop errors of earlier calls, only the allocation is checked.
+  while (glGetError() != GL_NO_ERROR) {}
+
+  glGenBuffers(1, &gl_buffer_c);
+  glBindBuffer(GL_ARRAY_BUFFER, gl_buffer_c);
+  glBufferData(GL_ARRAY_BUFFER, m_capacity * sizeof(cl_float4), nullptr, GL_STATIC_DRAW);
+  if (glGetError() == GL_NO_ERROR)
+    return true;
+  std::cerr << name() << ": cannot create a GL buffer of " << m_capacity << " elements.\n";
+  return false;
+}
+
+void TransferStrategy::uploadToGl(const void* data, size_t mem_size, IterationTiming& timing) {
+  HostClock::time_point upload_beg = HostClock::now();
+  glBindBuffer(GL_ARRAY_BUFFER, gl_buffer_c);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, mem_size * sizeof(cl_float4), data);
+  timing.upload_ms += elapsedMs(upload_beg, HostClock::now());
+}
+
+//===============================
+// gl: CL writes into a shared GL buffer (acquire/release)
+//===============================
+class GlInteropStrategy : public TransferStrategy {
+public:
+  const char* name() const { return "gl"; }
+
+  void beforeKernel(IterationEvents& events, IterationTiming& timing) {
+    HostClock::time_point beg = HostClock::now();
+    glFinish();
+    timing.gl_finish_ms = elapsedMs(beg, HostClock::now());
+    cl_int error = clEnqueueAcquireGLObjects(device->cmd_queue, 1, &device_c, 0, nullptr, events(events.acquire)); cl->checkError(error);
+  }
+
+  void transfer(size_t mem_size, IterationEvents& events, IterationTiming& timing) {
+    cl_int error = clEnqueueReleaseGLObjects(device->cmd_queue, 1, &device_c, 0, nullptr, events(events.release)); cl->checkError(error);
+  }
+
+protected:
+  bool createOutput() {
+    if (!device->features.has_cl_khr_gl_sharing){
+      std::cerr << "gl: the device does not support cl_khr_gl_sharing.\n";
+      return false;
+    }
+    cl_int error;
+    if (!createGlBuffer())
+      return false;
+    device_c = clCreateFromGLBuffer(device->ctx, CL_MEM_WRITE_ONLY, gl_buffer_c, &error); cl->checkError(error);
+    return error == CL_SUCCESS;
+  }
+};
+
+//===============================
+// gl_fence: the acquire waits for a GL fence instead of glFinish
+//===============================
+class GlFenceStrategy : public GlInteropStrategy {
+public:
+  GlFenceStrategy() : create_event_from_gl_sync(nullptr) {}
+
+  const char* name() const { return "gl_fence"; }
+
+  void beforeKernel(IterationEvents& events, IterationTiming& timing) {
+    retireFences(false);
+
+    HostClock::time_point beg = HostClock::now();
+    GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    cl_event gl_event = 0;
+    cl_int error;
+    if (create_event_from_gl_sync){
+      // the fence has to reach the GL server before CL waits for it.
+      glFlush();
+      gl_event = create_event_from_gl_sync(device->ctx, (cl_GLsync)fence, &error); cl->checkError(error);
+    }
+    else {
+      // without cl_khr_gl_event the host waits, but only for the commands before the fence.
+      glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    }
+    timing.gl_finish_ms = elapsedMs(beg, HostClock::now());
+
+    PendingFence pending = { fence, 0 };
+    error = clEnqueueAcquireGLObjects(device->cmd_queue, 1, &device_c, gl_event ? 1 : 0, gl_event ? &gl_event : nullptr, &pending.acquire); cl->checkError(error);
+    if (gl_event)
+      clReleaseEvent(gl_event);
+    if (events.profile && pending.acquire){
+      clRetainEvent(pending.acquire);
+      events.acquire = pending.acquire;
+    }
+    m_fences.push_back(pending);
+  }
+
+protected:
+  // A fence is deleted once the acquire waiting for it is complete.
+  struct PendingFence {
+    GLsync    fence;
+    cl_event  acquire;
+  };
+
+  bool createOutput() {
+    if (!GLEW_ARB_sync){
+      std::cerr << name() << ": GL_ARB_sync is not supported.\n";
+      return false;
+    }
+    if (device->features.hasExtension("cl_khr_gl_event")){
+      cl_platform_id platform;
+      clGetDeviceInfo(device->id, CL_DEVICE_PLATFORM, sizeof(platform), &platform, nullptr);
+      create_event_from_gl_sync = (clCreateEventFromGLsyncKHR_fn)clGetExtensionFunctionAddressForPlatform(platform, "clCreateEventFromGLsyncKHR");
+    }
+    if (!create_event_from_gl_sync)
+      std::cout << name() << ": no clCreateEventFromGLsyncKHR, the host waits for the GL fence.\n";
+    return GlInteropStrategy::createOutput();
+  }
+
+  void releaseOutput() {
+    retireFences(true);
+  }
+
+  // wait: also the fences whose acquire is still pending.
+  void retireFences(bool wait) {
+    while (!m_fences.empty()){
+      PendingFence& pending = m_fences.front();
+      if (pending.acquire){
+        cl_int status = CL_COMPLETE;
+        if (wait)
+          clWaitForEvents(1, &pending.acquire);
+        else
+          clGetEventInfo(pending.acquire, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(status), &status, nullptr);
+        if (status > CL_COMPLETE)
+          break;
+        clReleaseEvent(pending.acquire);
+      }
+      glDeleteSync(pending.fence);
+      m_fences.pop_front();
+    }
+  }
+
+  clCreateEventFromGLsyncKHR_fn create_event_from_gl_sync;
+  std::deque<PendingFence>      m_fences;
+};
+
+//===============================
+// gl_implicit: no host side GL synchronization, cl_khr_gl_event makes the acquire wait for GL
+//===============================
+class GlImplicitStrategy : public GlInteropStrategy {
+public:
+  const char* name() const { return "gl_implicit"; }
+
+  void beforeKernel(IterationEvents& events, IterationTiming& timing) {
+    cl_int error = clEnqueueAcquireGLObjects(device->cmd_queue, 1, &device_c, 0, nullptr, events(events.acquire)); cl->checkError(error);
+  }
+
+protected:
+  bool createOutput() {
+    // implicit synchronization with the current GL context is part of cl_khr_gl_event.
+    if (!device->features.hasExtension("cl_khr_gl_event")){
+      std::cerr << name() << ": the device does not support cl_khr_gl_event.\n";
+      return false;
+    }
+    return GlInteropStrategy::createOutput();
+  }
+};
+
+//===============================
+// read: blocking read back into pageable host memory
+//===============================
+class ReadStrategy : public TransferStrategy {
+public:
+  ReadStrategy() : temp_mem(nullptr) {}
+
+  const char* name() const { return "read"; }
+
+  void transfer(size_t mem_size, IterationEvents& events, IterationTiming& timing) {
+    cl_int error = clEnqueueReadBuffer(device->cmd_queue, device_c, CL_TRUE, 0, mem_size * sizeof(cl_float4), temp_mem, 0, nullptr, events(events.read)); cl->checkError(error);
+  }
+
+protected:
+  bool createOutput() {
+    device_c = createDeviceBuffer(m_capacity * sizeof(cl_float4), CL_MEM_WRITE_ONLY);
+    temp_mem = static_cast<cl_float4*>(HostBufferPool::getSingletonPtr()->acquire(m_capacity * sizeof(cl_float4)));
+    return device_c && temp_mem;
+  }
+
+  void releaseOutput() {
+    HostBufferPool::getSingletonPtr()->release(temp_mem);
+    temp_mem = nullptr;
+  }
+
+  cl_float4* temp_mem;   // pooled staging memory
+};
+
+//===============================
+// copy: blocking read back + glBufferSubData
+//===============================
+class ReadUploadStrategy : public ReadStrategy {
+public:
+  const char* name() const { return "copy"; }
+
+  void transfer(size_t mem_size, IterationEvents& events, IterationTiming& timing) {
+    ReadStrategy::transfer(mem_size, events, timing);
+    uploadToGl(temp_mem, mem_size, timing);
+  }
+
+protected:
+  bool createOutput() {
+    return createGlBuffer() && ReadStrategy::createOutput();
+  }
+};
+
+//===============================
+// pinned: device_c in CL_MEM_ALLOC_HOST_PTR memory, mapped for the upload
+//===============================
+class PinnedMapStrategy : public TransferStrategy {
+public:
+  const char* name() const { return "pinned"; }
+
+  void transfer(size_t mem_size, IterationEvents& events, IterationTiming& timing) {
+    cl_int error;
+    void* ptr = clEnqueueMapBuffer(device->cmd_queue, device_c, CL_TRUE, CL_MAP_READ, 0, mem_size * sizeof(cl_float4), 0, nullptr, events(events.read), &error); cl->checkError(error);
+    if (!ptr)
+      return;
+    uploadToGl(ptr, mem_size, timing);
+    error = clEnqueueUnmapMemObject(device->cmd_queue, device_c, ptr, 0, nullptr, events(events.release)); cl->checkError(error);
+  }
+
+protected:
+  bool createOutput() {
+    cl_int error;
+    if (!createGlBuffer())
+      return false;
+    device_c = clCreateBuffer(device->ctx, CL_MEM_WRITE_ONLY | CL_MEM_ALLOC_HOST_PTR, m_capacity * sizeof(cl_float4), nullptr, &error); cl->checkError(error);
+    return error == CL_SUCCESS;
+  }
+};
+
+//===============================
+// zero_copy: device_c wraps page aligned host memory (CL_MEM_USE_HOST_PTR)
+//===============================
+class ZeroCopyStrategy : public TransferStrategy {
+public:
+  ZeroCopyStrategy() : host_c(nullptr) {}
+
+  const char* name() const { return "zero_copy"; }
+
+  void transfer(size_t mem_size, IterationEvents& events, IterationTiming& timing) {
+    // mapping a USE_HOST_PTR buffer only synchronizes, it returns host_c on zero copy devices.
+    cl_int error;
+    void* ptr = clEnqueueMapBuffer(device->cmd_queue, device_c, CL_TRUE, CL_MAP_READ, 0, mem_size * sizeof(cl_float4), 0, nullptr, events(events.read), &error); cl->checkError(error);
+    if (!ptr)
+      return;
+    uploadToGl(ptr, mem_size, timing);
+    error = clEnqueueUnmapMemObject(device->cmd_queue, device_c, ptr, 0, nullptr, events(events.release)); cl->checkError(error);
+  }
+
+protected:
+  bool createOutput() {
+    cl_int error;
+    if (!createGlBuffer())
+      return false;
+
+    // pooled blocks are page aligned and a multiple of the page size, which keeps the runtimes from copying.
+    host_c = HostBufferPool::getSingletonPtr()->acquire(m_capacity * sizeof(cl_float4));
+    if (!host_c)
+      return false;
+    device_c = clCreateBuffer(device->ctx, CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR, m_capacity * sizeof(cl_float4), host_c, &error); cl->checkError(error);
+    return error == CL_SUCCESS;
+  }
+
+  void releaseOutput() {
+    // device_c has to go before its host memory.
+    if (device_c)
+      clReleaseMemObject(device_c);
+    device_c = 0;
+    HostBufferPool::getSingletonPtr()->release(host_c);
+    host_c = nullptr;
+  }
+
+  void* host_c;
+};
+
+//===============================
+// async_read: non-blocking chunked read back, uploading chunk i while chunk i+1 is read
+//===============================
+class AsyncReadStrategy : public ReadStrategy {
+public:
+  static const size_t n_chunks = 4;
+
+  const char* name() const { return "async_read"; }
+
+  void transfer(size_t mem_size, IterationEvents& events, IterationTiming& timing) {
+    cl_int error;
+    cl_event chunk_events[n_chunks] = { 0 };
+    size_t chunk_size = (mem_size + n_chunks - 1) / n_chunks;
+
+    // the in-order queue chains every read after the kernel.
+    for (size_t c = 0; c < n_chunks; c++){
+      size_t offset = std::min(c * chunk_size, mem_size);
+      size_t count = std::min(chunk_size, mem_size - offset);
+      if (count == 0)
+        break;
+      error = clEnqueueReadBuffer(device->cmd_queue, device_c, CL_FALSE, offset * sizeof(cl_float4), count * sizeof(cl_float4),
+                                  &temp_mem[offset], 0, nullptr, &chunk_events[c]); cl->checkError(error);
+    }
+    clFlush(device->cmd_queue);
+
+    glBindBuffer(GL_ARRAY_BUFFER, gl_buffer_c);
+    for (size_t c = 0; c < n_chunks && chunk_events[c]; c++){
+      clWaitForEvents(1, &chunk_events[c]);
+
+      size_t offset = c * chunk_size;
+      size_t count = std::min(chunk_size, mem_size - offset);
+      HostClock::time_point upload_beg = HostClock::now();
+      glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(cl_float4), count * sizeof(cl_float4), &temp_mem[offset]);
+      timing.upload_ms += elapsedMs(upload_beg, HostClock::now());
+    }
+
+    // report the chunks as one read: from the first queued to the last finished.
+    if (events.profile && chunk_events[0]){
+      ClEventTiming first = getEventTiming(chunk_events[0]);
+      for (size_t c = 1; c < n_chunks && chunk_events[c]; c++)
+        first.end = std::max(first.end, getEventTiming(chunk_events[c]).end);
+      timing.read = first;
+    }
+    for (size_t c = 0; c < n_chunks && chunk_events[c]; c++)
+      clReleaseEvent(chunk_events[c]);
+  }
+
+protected:
+  bool createOutput() {
+    return createGlBuffer() && ReadStrategy::createOutput();
+  }
+};
+
+//===============================
+// gl_persistent: read back straight into a mapped GL buffer
+//===============================
+class GlPersistentStrategy : public TransferStrategy {
+public:
+  GlPersistentStrategy() : persistent_ptr(nullptr) {}
+
+  const char* name() const { return "gl_persistent"; }
+
+  void transfer(size_t mem_size, IterationEvents& events, IterationTiming& timing) {
+    cl_int error;
+    void* ptr = persistent_ptr;
+
+    HostClock::time_point map_beg = HostClock::now();
+    if (!ptr){
+      // without buffer storage: unsynchronized map per iteration.
+      glBindBuffer(GL_ARRAY_BUFFER, gl_buffer_c);
+      ptr = glMapBufferRange(GL_ARRAY_BUFFER, 0, mem_size * sizeof(cl_float4), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    }
+    timing.upload_ms += elapsedMs(map_beg, HostClock::now());
+    if (!ptr)
+      return;
+
+    error = clEnqueueReadBuffer(device->cmd_queue, device_c, CL_TRUE, 0, mem_size * sizeof(cl_float4), ptr, 0, nullptr, events(events.read)); cl->checkError(error);
+
+    if (!persistent_ptr){
+      HostClock::time_point unmap_beg = HostClock::now();
+      glUnmapBuffer(GL_ARRAY_BUFFER);
+      timing.upload_ms += elapsedMs(unmap_beg, HostClock::now());
+    }
+  }
+
+protected:
+  bool createOutput() {
+    device_c = createDeviceBuffer(m_capacity * sizeof(cl_float4), CL_MEM_WRITE_ONLY);
+
+    while (glGetError() != GL_NO_ERROR) {}
+    glGenBuffers(1, &gl_buffer_c);
+    glBindBuffer(GL_ARRAY_BUFFER, gl_buffer_c);
+    GLsizeiptr bytes = m_capacity * sizeof(cl_float4);
+    if (GLEW_ARB_buffer_storage){
+      // coherent: writes become visible to GL without an explicit flush.
+      GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+      glBufferStorage(GL_ARRAY_BUFFER, bytes, nullptr, flags);
+      persistent_ptr = glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, flags);
+    }
+    else {
+      std::cout << "gl_persistent: GL_ARB_buffer_storage is not supported, mapping unsynchronized per iteration.\n";
+      glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+    }
+
+    return device_c && glGetError() == GL_NO_ERROR;
+  }
+
+  void releaseOutput() {
+    if (persistent_ptr){
+      glBindBuffer(GL_ARRAY_BUFFER, gl_buffer_c);
+      glUnmapBuffer(GL_ARRAY_BUFFER);
+      persistent_ptr = nullptr;
+    }
+  }
+
+  void* persistent_ptr;
+};
+
+//===============================
+// cl_copy: device to device copy, the baseline without any host or GL involvement
+//===============================
+class ClCopyStrategy : public TransferStrategy {
+public:
+  ClCopyStrategy() : device_d(0) {}
+
+  const char* name() const { return "cl_copy"; }
+
+  void transfer(size_t mem_size, IterationEvents& events, IterationTiming& timing) {
+    cl_int error = clEnqueueCopyBuffer(device->cmd_queue, device_c, device_d, 0, 0, mem_size * sizeof(cl_float4), 0, nullptr, events(events.read)); cl->checkError(error);
+  }
+
+protected:
+  bool createOutput() {
+    device_c = createDeviceBuffer(m_capacity * sizeof(cl_float4), CL_MEM_READ_WRITE);
+    device_d = createDeviceBuffer(m_capacity * sizeof(cl_float4), CL_MEM_READ_WRITE);
+    return device_c && device_d;
+  }
+
+  void releaseOutput() {
+    releaseDeviceBuffer(device_d);
+  }
+
+  cl_mem device_d;
+};
+
+//===============================
+// svm: a and c in coarse grained shared virtual memory (OpenCL 2.0), mapped instead of read back
+//===============================
+class SvmStrategy : public TransferStrategy {
+public:
+  SvmStrategy(bool fine_grain = false) : fine_grain(fine_grain), svm_a(nullptr), svm_c(nullptr) {}
+
+  const char* name() const { return fine_grain ? "svm_fine" : "svm"; }
+
+  void setKernelArgs(cl_kernel kernel) {
+    clSetKernelArgSVMPointer(kernel, 0, svm_a);
+    clSetKernelArgSVMPointer(kernel, 1, svm_c);
+  }
+
+  void transfer(size_t mem_size, IterationEvents& events, IterationTiming& timing) {
+    // fine grained memory is visible to the host once the kernel finished, there is nothing to move.
+    if (fine_grain)
+      return;
+    // on unified memory mapping only synchronizes, discrete devices copy here.
+    cl_int error = clEnqueueSVMMap(device->cmd_queue, CL_TRUE, CL_MAP_READ, svm_c, mem_size * sizeof(cl_float4), 0, nullptr, events(events.read)); cl->checkError(error);
+    error = clEnqueueSVMUnmap(device->cmd_queue, svm_c, 0, nullptr, events(events.release)); cl->checkError(error);
+  }
+
+protected:
+  cl_svm_mem_flags svmFlags() const {
+    return CL_MEM_READ_WRITE | (fine_grain ? CL_MEM_SVM_FINE_GRAIN_BUFFER : 0);
+  }
+
+  bool createInput() {
+    cl_bitfield needed = fine_grain ? CL_DEVICE_SVM_FINE_GRAIN_BUFFER : CL_DEVICE_SVM_COARSE_GRAIN_BUFFER;
+    if (!(device->features.svm_capabilities & needed)){
+      std::cerr << name() << ": the device does not support " << (fine_grain ? "fine" : "coarse") << " grained SVM buffers.\n";
+      return false;
+    }
+    svm_a = clSVMAlloc(device->ctx, svmFlags(), m_capacity * sizeof(cl_float4), 0);
+    return svm_a != nullptr;
+  }
+
+  void* mapInput() {
+    // fine grained memory is written in place.
+    if (fine_grain)
+      return svm_a;
+    cl_int error = clEnqueueSVMMap(device->cmd_queue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, svm_a, m_capacity * sizeof(cl_float4), 0, nullptr, nullptr); cl->checkError(error);
+    return error == CL_SUCCESS ? svm_a : nullptr;
+  }
+
+  void unmapInput(void* ptr) {
+    if (fine_grain)
+      return;
+    cl_int error = clEnqueueSVMUnmap(device->cmd_queue, ptr, 0, nullptr, nullptr); cl->checkError(error);
+  }
+
+  bool writeInput(const cl_float4* host_a) {
+    cl_int error = clEnqueueSVMMemcpy(device->cmd_queue, CL_TRUE, svm_a, host_a, m_capacity * sizeof(cl_float4), 0, nullptr, nullptr); cl->checkError(error);
+    return error == CL_SUCCESS;
+  }
+
+  void releaseInput() {
+    if (svm_a)
+      clSVMFree(device->ctx, svm_a);
+    svm_a = nullptr;
+  }
+
+  bool createOutput() {
+    svm_c = clSVMAlloc(device->ctx, svmFlags(), m_capacity * sizeof(cl_float4), 0);
+    return svm_c != nullptr;
+  }
+
+  void releaseOutput() {
+    if (svm_c)
+      clSVMFree(device->ctx, svm_c);
+    svm_c = nullptr;
+  }
+
+  bool  fine_grain;
+  void* svm_a;
+  void* svm_c;
+};
+
+//===============================
+// svm_fine: fine grained SVM buffers, the host reads the kernel output in place
+//===============================
+class SvmFineStrategy : public SvmStrategy {
+public:
+  SvmFineStrategy() : SvmStrategy(true) {}
+};
+
+//===============================
+// Registry
+//===============================
+struct TransferStrategyInfo {
+  const char*         name;
+  bool                needs_gl;     // needs a current GL context, also behind TransferStrategy::needsGl
+  TransferStrategy*   (*create)();
+};
+
+template <class T>
+static TransferStrategy* newStrategy() {
+  return new T();
+}
+
+static const TransferStrategyInfo strategies[] = {
+  { "gl",             true,   &newStrategy<GlInteropStrategy> },
+  { "gl_fence",       true,   &newStrategy<GlFenceStrategy> },
+  { "gl_implicit",    true,   &newStrategy<GlImplicitStrategy> },
+  { "copy",           true,   &newStrategy<ReadUploadStrategy> },
+  { "read",           false,  &newStrategy<ReadStrategy> },
+  { "pinned",         true,   &newStrategy<PinnedMapStrategy> },
+  { "zero_copy",      true,   &newStrategy<ZeroCopyStrategy> },
+  { "async_read",     true,   &newStrategy<AsyncReadStrategy> },
+  { "gl_persistent",  true,   &newStrategy<GlPersistentStrategy> },
+  { "cl_copy",        false,  &newStrategy<ClCopyStrategy> },
+  { "svm",            false,  &newStrategy<SvmStrategy> },
+  { "svm_fine",       false,  &newStrategy<SvmFineStrategy> },
+};
+static const size_t n_strategies = sizeof(strategies) / sizeof(strategies[0]);
+
+TransferStrategy* createTransferStrategy(const std::string& name) {
+  for (size_t i = 0; i < n_strategies; i++) {
+    if (name == strategies[i].name)
+      return strategies[i].create();
+  }
+  return nullptr;
+}
+
+std::vector<std::string> transferStrategyNames() {
+  std::vector<std::string> names;
+  for (size_t i = 0; i < n_strategies; i++)
+    names.push_back(strategies[i].name);
+  return names;
+}
+
+bool isTransferStrategy(const std::string& name) {
+  for (size_t i = 0; i < n_strategies; i++) {
+    if (name == strategies[i].name)
+      return true;
+  }
+  return false;
+}
+
+bool transferStrategyNeedsGl(const std::string& name) {
+  for (size_t i = 0; i < n_strategies; i++) {
+    if (name == strategies[i].name)
+      return strategies[i].needs_gl;
+  }
+  return false;
+}
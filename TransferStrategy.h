@@ -0,0 +1,95 @@
+#ifndef __TRANSFER_STRATEGY_H__
+#define __TRANSFER_STRATEGY_H__
+
+// STD
+#include <vector>
+#include <string>
+
+#include "ClContext.h"
+#include "ClProfiling.h"
+#include "InputGenerator.h"
+
+// Events of the commands of one iteration. They are only requested while profiling.
+struct IterationEvents {
+  bool      profile;
+  cl_event  acquire;
+  cl_event  kernel;
+  cl_event  read;
+  cl_event  release;
+
+  IterationEvents(bool profile);
+
+  // the event argument for an enqueue call
+  cl_event* operator()(cl_event& event) { return profile ? &event : nullptr; }
+
+  // Reads the timestamps of the requested events into timing and releases them.
+  void collect(IterationTiming& timing);
+};
+
+// A way of moving the output of the copy kernel (device_c) to its consumer.
+// Buffers are created once for the largest size and reused for every smaller one.
+class TransferStrategy {
+public:
+  TransferStrategy();
+  virtual ~TransferStrategy();
+
+  virtual const char* name() const = 0;
+  // as registered, see transferStrategyNeedsGl
+  bool needsGl() const;
+
+  // Creates device_a (filled with the input data of seed, see InputGenerator), device_c and whatever
+  // the strategy needs on top. fill_mapped generates the input straight into the mapped device_a,
+  // otherwise into host staging memory that is written to device_a.
+  bool create(ClContext* cl, const ClDevice& device, size_t capacity,
+              unsigned long long seed = default_input_seed, bool fill_mapped = true);
+  void release();
+
+  // Sets the input and the output as the kernel arguments 0 and 1.
+  virtual void setKernelArgs(cl_kernel kernel);
+
+  // Called before the kernel is enqueued, e.g. to acquire GL objects.
+  virtual void beforeKernel(IterationEvents& events, IterationTiming& timing) {}
+
+  // Moves mem_size elements of device_c to the destination after the kernel was enqueued.
+  virtual void transfer(size_t mem_size, IterationEvents& events, IterationTiming& timing) = 0;
+
+  cl_mem  input() const { return device_a; }
+  cl_mem  output() const { return device_c; }
+  size_t  capacity() const { return m_capacity; }
+
+protected:
+  // device_a with room for m_capacity elements, filled by either mapInput/unmapInput or writeInput.
+  virtual bool createInput();
+  virtual void releaseInput() {}
+  virtual void* mapInput();
+  virtual void unmapInput(void* ptr);
+  virtual bool writeInput(const cl_float4* host_a);
+
+  // device_c and the strategy specific resources
+  virtual bool createOutput() = 0;
+  virtual void releaseOutput() {}
+
+  // plain device memory: a sub-buffer of the device pool if there is one, clCreateBuffer otherwise.
+  // releaseDeviceBuffer also takes buffers of any other origin.
+  cl_mem createDeviceBuffer(size_t bytes, cl_mem_flags flags);
+  void releaseDeviceBuffer(cl_mem& mem);
+
+  bool createGlBuffer();
+  void uploadToGl(const void* data, size_t mem_size, IterationTiming& timing);
+
+  ClContext*      cl;
+  const ClDevice* device;
+  cl_mem          device_a;
+  cl_mem          device_c;
+  unsigned int    gl_buffer_c;
+  size_t          m_capacity;
+};
+
+// Creates the strategy registered under name, returns nullptr for unknown names.
+TransferStrategy* createTransferStrategy(const std::string& name);
+
+std::vector<std::string> transferStrategyNames();
+bool isTransferStrategy(const std::string& name);
+bool transferStrategyNeedsGl(const std::string& name);
+
+#endif
@@ -1,443 +1,334 @@
 #include <iostream>
+#include <algorithm>
 #include <time.h>
+#include <stdio.h>
 #include <GL/glew.h>
 
-#include "ClContext.h"
-
 #ifdef _WIN32
-  #include <GLFW/glfw3.h>
-#elif _LINUX
-  #include <stdio.h>
-  #include <stdlib.h>
-  #include <string.h>
+  #include <io.h>
+  #define dup _dup
+  #define dup2 _dup2
+  #define fdopen _fdopen
+#else
   #include <unistd.h>
-  #include <X11/Xlib.h>
-  #include <X11/Xutil.h>
-  #include <GL/gl.h>
-  #include <GL/glx.h>
 #endif
 
+#include "ClContext.h"
+#include "ClProgramCache.h"
+#include "BenchOptions.h"
+#include "BenchReport.h"
+#include "Benchmark.h"
+#include "PipelinedBenchmark.h"
+#include "MultiDeviceBenchmark.h"
+#include "GlSyncBenchmark.h"
+#include "BatchedBenchmark.h"
+#include "OverheadBenchmark.h"
+#include "DeviceProfile.h"
+#include "HostBufferPool.h"
+#include "ClMemPool.h"
+#include "GlBackend.h"
+
 // BOOST
 #include <boost/thread.hpp>
-
-GLFWwindow* win[10];
-
-void initGlfw(){
-  // initialize the glfw
-  if (!glfwInit())
-    exit(EXIT_FAILURE);
-
-  int num_monitors = -1;
-  GLFWmonitor** monitors = glfwGetMonitors(&num_monitors);
-
-  for(int i = 0;  i < num_monitors; i++){
-      // create the window
-      win[i] = glfwCreateWindow(600, 400, "TEST GPU Buffer", NULL, NULL);
-      if (!win[i])
-      {
-        glfwTerminate();
-        exit(EXIT_FAILURE);
-      }
-
-      // Make the current window as the current gl context
-      glfwMakeContextCurrent(win[i]);
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
+
+// prints the program cache hits and writes the build report, if requested.
+static bool reportBuilds(ClContext* cl, const BenchOptions& options){
+  if (cl->getProgramCache())
+    cl->getProgramCache()->printReport();
+  if (options.build_report.empty())
+    return true;
+
+  BenchReport report;
+  std::vector<ClBuildRecord> builds = cl->getBuildRecords();
+  for (size_t b = 0; b < builds.size(); b++){
+    BenchRecord record;
+    record.set("file", builds[b].file_name);
+    record.set("device", builds[b].device_name);
+    record.set("options", builds[b].options);
+    record.set("success", builds[b].success);
+    record.set("error", builds[b].error);
+    record.set("duration_ms", builds[b].duration_ms);
+    record.set("log", builds[b].log);
+    report.add(record);
   }
-
+  return report.write(options.build_report);
 }
 
-#ifdef _LINUX
-#define GLX_CONTEXT_MAJOR_VERSION_ARB       0x2091
-#define GLX_CONTEXT_MINOR_VERSION_ARB       0x2092
-typedef GLXContext (*glXCreateContextAttribsARBProc)(Display*, GLXFBConfig, GLXContext, Bool, const int*);
-
-// Helper to check for extension string presence.  Adapted from:
-//   http://www.opengl.org/resources/features/OGLextensions/
-static bool isExtensionSupported(const char *extList, const char *extension)
-{
-  const char *start;
-  const char *where, *terminator;
-
-  /* Extension names should not have spaces. */
-  where = strchr(extension, ' ');
-  if (where || *extension == '\0')
-    return false;
-
-  /* It takes a bit of care to be fool-proof about parsing the
-     OpenGL extensions string. Don't be fooled by sub-strings,
-     etc. */
-  for (start=extList;;) {
-    where = strstr(start, extension);
-
-    if (!where)
-      break;
-
-    terminator = where + strlen(extension);
-
-    if ( where == start || *(where - 1) == ' ' )
-      if ( *terminator == ' ' || *terminator == '\0' )
-        return true;
-
-    start = terminator;
-  }
-
-  return false;
+// usage of the device memory pool after a run, which leaves it idle.
+static void reportMemPool(ClContext* cl, const ClDevice& device, BenchReport& report){
+  ClMemPool* pool = cl->getMemPool(device);
+  if (!pool)
+    return;
+  pool->printReport();
+  report.add(pool->toRecord());
+  pool->defragment();
 }
 
-static bool ctxErrorOccurred = false;
-static int ctxErrorHandler( Display *dpy, XErrorEvent *ev )
-{
-    ctxErrorOccurred = true;
-    return 0;
+// Loads the GL entry points for the current context. EGL needs a GLEW built with GLEW_EGL, whose
+// glewInit loads through eglGetProcAddress. A GLX build of GLEW fails on the missing GLX display
+// before loading anything, glewContextInit skips that check and loads through glXGetProcAddress,
+// which dispatches to the current EGL context where both share one GL library (libglvnd, Mesa).
+static bool initGlew(const GlBackend& context){
+  GLenum result = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+  if (result == GLEW_ERROR_NO_GLX_DISPLAY && std::string(context.name()) == "egl")
+    result = glewContextInit();
+#endif
+  return result == GLEW_OK;
 }
-void initGlx(const char* display_str, Display* display, Window& win, GLXContext& ctx){
-    display = XOpenDisplay(display_str);
 
-    if (!display)
-    {
-      printf("Failed to open X display\n");
-      exit(1);
-    }
-
-    // Get a matching FB config
-    static int visual_attribs[] =
-      {
-        GLX_X_RENDERABLE    , True,
-        GLX_DRAWABLE_TYPE   , GLX_WINDOW_BIT,
-        GLX_RENDER_TYPE     , GLX_RGBA_BIT,
-        GLX_X_VISUAL_TYPE   , GLX_TRUE_COLOR,
-        GLX_RED_SIZE        , 8,
-        GLX_GREEN_SIZE      , 8,
-        GLX_BLUE_SIZE       , 8,
-        GLX_ALPHA_SIZE      , 8,
-        GLX_DEPTH_SIZE      , 24,
-        GLX_STENCIL_SIZE    , 8,
-        GLX_DOUBLEBUFFER    , True,
-        //GLX_SAMPLE_BUFFERS  , 1,
-        //GLX_SAMPLES         , 4,
-        None
-      };
-
-    int glx_major, glx_minor;
-
-    // FBConfigs were added in GLX version 1.3.
-    if ( !glXQueryVersion( display, &glx_major, &glx_minor ) ||
-         ( ( glx_major == 1 ) && ( glx_minor < 3 ) ) || ( glx_major < 1 ) )
-    {
-      printf("Invalid GLX version");
-      exit(1);
-    }
-
-    printf( "Getting matching framebuffer configs\n" );
-    int fbcount;
-    GLXFBConfig* fbc = glXChooseFBConfig(display, DefaultScreen(display), visual_attribs, &fbcount);
-    if (!fbc)
-    {
-      printf( "Failed to retrieve a framebuffer config\n" );
-      exit(1);
-    }
-    printf( "Found %d matching FB configs.\n", fbcount );
-
-    // Pick the FB config/visual with the most samples per pixel
-    printf( "Getting XVisualInfos\n" );
-    int best_fbc = -1, worst_fbc = -1, best_num_samp = -1, worst_num_samp = 999;
-
-    int i;
-    for (i=0; i<fbcount; ++i)
-    {
-      XVisualInfo *vi = glXGetVisualFromFBConfig( display, fbc[i] );
-      if ( vi )
-      {
-        int samp_buf, samples;
-        glXGetFBConfigAttrib( display, fbc[i], GLX_SAMPLE_BUFFERS, &samp_buf );
-        glXGetFBConfigAttrib( display, fbc[i], GLX_SAMPLES       , &samples  );
-
-        printf( "  Matching fbconfig %d, visual ID 0x%2x: SAMPLE_BUFFERS = %d,"
-                " SAMPLES = %d\n",
-                i, vi -> visualid, samp_buf, samples );
-
-        if ( best_fbc < 0 || samp_buf && samples > best_num_samp )
-          best_fbc = i, best_num_samp = samples;
-        if ( worst_fbc < 0 || !samp_buf || samples < worst_num_samp )
-          worst_fbc = i, worst_num_samp = samples;
+// --devices: resolves the selectors (after partitioning the CPUs into sub-devices),
+// builds the kernel for every device and runs the multi-device benchmark.
+int runMultiDeviceMain(ClContext* cl, const BenchOptions& options){
+  std::vector<int> partitioned;
+  if (options.sub_devices > 0){
+    size_t n_devices = cl->devices.size();
+    for (size_t d = 0; d < n_devices; d++){
+      if (cl->devices[d].features.device_type & CL_DEVICE_TYPE_CPU){
+        if (!cl->createSubDevices(static_cast<int>(d), static_cast<cl_uint>(options.sub_devices)).empty())
+          partitioned.push_back(static_cast<int>(d));
       }
-      XFree( vi );
     }
+  }
 
-    GLXFBConfig bestFbc = fbc[ best_fbc ];
-
-    // Be sure to free the FBConfig list allocated by glXChooseFBConfig()
-    XFree( fbc );
-
-    // Get a visual
-    XVisualInfo *vi = glXGetVisualFromFBConfig( display, bestFbc );
-    printf( "Chosen visual ID = 0x%x\n", vi->visualid );
-
-    printf( "Creating colormap\n" );
-    XSetWindowAttributes swa;
-    Colormap cmap;
-    swa.colormap = cmap = XCreateColormap( display,
-                                           RootWindow( display, vi->screen ),
-                                           vi->visual, AllocNone );
-    swa.background_pixmap = None ;
-    swa.border_pixel      = 0;
-    swa.event_mask        = StructureNotifyMask;
-
-    printf( "Creating window\n" );
-    win = XCreateWindow( display, RootWindow( display, vi->screen ),
-                                0, 0, 100, 100, 0, vi->depth, InputOutput,
-                                vi->visual,
-                                CWBorderPixel|CWColormap|CWEventMask, &swa );
-    if ( !win )
-    {
-      printf( "Failed to create window.\n" );
-      exit(1);
+  std::vector<int> device_indices;
+  for (size_t s = 0; s < options.devices.size(); s++){
+    if (options.devices[s] == "all"){
+      // a partitioned device is represented by its sub-devices
+      for (size_t d = 0; d < cl->devices.size(); d++){
+        if (std::find(partitioned.begin(), partitioned.end(), static_cast<int>(d)) == partitioned.end())
+          device_indices.push_back(static_cast<int>(d));
+      }
+      continue;
     }
-
-    // Done with the visual info data
-    XFree( vi );
-
-    XStoreName( display, win, "GL 3.0 Window" );
-
-    printf( "Mapping window\n" );
-    XMapWindow( display, win );
-
-    // Get the default screen's GLX extension list
-    const char *glxExts = glXQueryExtensionsString( display,
-                                                    DefaultScreen( display ) );
-
-    // NOTE: It is not necessary to create or make current to a context before
-    // calling glXGetProcAddressARBWindow
-    glXCreateContextAttribsARBProc glXCreateContextAttribsARB = 0;
-    glXCreateContextAttribsARB = (glXCreateContextAttribsARBProc)
-             glXGetProcAddressARB( (const GLubyte *) "glXCreateContextAttribsARB" );
-
-    ctx = 0;
-
-    // Install an X error handler so the application won't exit if GL 3.0
-    // context allocation fails.
-    //
-    // Note this error handler is global.  All display connections in all threads
-    // of a process use the same error handler, so be sure to guard against other
-    // threads issuing X commands while this code is running.
-    ctxErrorOccurred = false;
-    int (*oldHandler)(Display*, XErrorEvent*) =
-        XSetErrorHandler(&ctxErrorHandler);
-
-    // Check for the GLX_ARB_create_context extension string and the function.
-    // If either is not present, use GLX 1.3 context creation method.
-    if ( !isExtensionSupported( glxExts, "GLX_ARB_create_context" ) ||
-         !glXCreateContextAttribsARB )
-    {
-      printf( "glXCreateContextAttribsARB() not found"
-              " ... using old-style GLX context\n" );
-      ctx = glXCreateNewContext( display, bestFbc, GLX_RGBA_TYPE, 0, True );
+    int dev_idx = cl->findDevice(options.devices[s]);
+    if (dev_idx < 0){
+      std::cerr << "No device matches \"" << options.devices[s] << "\"\n";
+      return 1;
     }
+    device_indices.push_back(dev_idx);
+  }
 
-    // If it does, try to get a GL 3.0 context!
+  // a device selected twice would share its registry kernel between two threads.
+  std::vector<int> unique_indices;
+  for (size_t d = 0; d < device_indices.size(); d++){
+    if (std::find(unique_indices.begin(), unique_indices.end(), device_indices[d]) == unique_indices.end())
+      unique_indices.push_back(device_indices[d]);
     else
-    {
-      int context_attribs[] =
-        {
-          GLX_CONTEXT_MAJOR_VERSION_ARB, 3,
-          GLX_CONTEXT_MINOR_VERSION_ARB, 0,
-          //GLX_CONTEXT_FLAGS_ARB        , GLX_CONTEXT_FORWARD_COMPATIBLE_BIT_ARB,
-          None
-        };
-
-      printf( "Creating context\n" );
-      ctx = glXCreateContextAttribsARB( display, bestFbc, 0,
-                                        True, context_attribs );
-
-      // Sync to ensure any errors generated are processed.
-      XSync( display, False );
-      if ( !ctxErrorOccurred && ctx )
-        printf( "Created GL 3.0 context\n" );
-      else
-      {
-        // Couldn't create GL 3.0 context.  Fall back to old-style 2.x context.
-        // When a context version below 3.0 is requested, implementations will
-        // return the newest context version compatible with OpenGL versions less
-        // than version 3.0.
-        // GLX_CONTEXT_MAJOR_VERSION_ARB = 1
-        context_attribs[1] = 1;
-        // GLX_CONTEXT_MINOR_VERSION_ARB = 0
-        context_attribs[3] = 0;
-
-        ctxErrorOccurred = false;
-
-        printf( "Failed to create GL 3.0 context"
-                " ... using old-style GLX context\n" );
-        ctx = glXCreateContextAttribsARB( display, bestFbc, 0,
-                                          True, context_attribs );
-      }
+      std::cout << "Device " << cl->devices[device_indices[d]].features.device_name << " is selected twice, running it once\n";
+  }
+  device_indices = unique_indices;
+  if (device_indices.empty()){
+    std::cerr << "No device selected\n";
+    return 1;
+  }
+
+  // auto: the strategies all devices agree on, the plain read back otherwise.
+  BenchOptions run_options = options;
+  if (run_options.modes.size() == 1 && run_options.modes[0] == "auto"){
+    run_options.modes = autoModes(cl->devices[device_indices[0]].features);
+    for (size_t d = 1; d < device_indices.size(); d++){
+      if (autoModes(cl->devices[device_indices[d]].features) != run_options.modes)
+        run_options.modes = autoModes(ClDeviceFeatures());
     }
+  }
+  for (size_t d = 0; d < device_indices.size(); d++)
+    run_options.sizes = fitSizes(cl->devices[device_indices[d]].features, run_options.sizes);
 
-    // Sync to ensure any errors generated are processed.
-    XSync( display, False );
+  if (run_options.sizes.empty()){
+    std::cerr << "None of the sizes fits all devices\n";
+    return 1;
+  }
 
-    // Restore the original error handler
-    XSetErrorHandler( oldHandler );
+  // all devices compile at the same time.
+  std::vector< boost::shared_future<const ClProgramEntry*> > builds;
+  for (size_t d = 0; d < device_indices.size(); d++)
+    builds.push_back(cl->getProgramAsync(options.kernel_file, ClContext::default_build_options, cl->devices[device_indices[d]]));
+  for (size_t d = 0; d < builds.size(); d++)
+    builds[d].wait();
+
+  std::vector<cl_kernel> kernels;
+  for (size_t d = 0; d < device_indices.size(); d++){
+    cl_kernel kernel = cl->createKernel(options.kernel_file, "myKernel", cl->devices[device_indices[d]]);
+    if (!kernel)
+      break;
+    kernels.push_back(kernel);
+  }
+  bool reported = reportBuilds(cl, options);
+
+  int exit_code = 0;
+  BenchReport report;
+  if (reported && kernels.size() == device_indices.size()){
+    runMultiDevice(cl, device_indices, kernels, run_options, report);
+    HostBufferPool::getSingletonPtr()->printReport();
+    report.add(HostBufferPool::getSingletonPtr()->toRecord());
+    for (size_t d = 0; d < device_indices.size(); d++)
+      reportMemPool(cl, cl->devices[device_indices[d]], report);
+    if (!report.write(options.output))
+      exit_code = 1;
+  }
+  else
+    exit_code = 1;
 
-    if ( ctxErrorOccurred || !ctx )
-    {
-      printf( "Failed to create an OpenGL context\n" );
-      exit(1);
-    }
+  for (size_t k = 0; k < kernels.size(); k++)
+    clReleaseKernel(kernels[k]);
+  cl->releasePrograms();
+  return exit_code;
+}
 
-    // Verifying that context is a direct context
-    if ( ! glXIsDirect ( display, ctx ) )
-    {
-      printf( "Indirect GLX rendering context obtained\n" );
-    }
-    else
-    {
-      printf( "Direct GLX rendering context obtained\n" );
+void myThread(const BenchOptions& options, int& exit_code){
+  exit_code = 0;
+  bool use_gl = optionsNeedGl(options);
+  cl_command_queue_properties queue_properties = options.profile ? CL_QUEUE_PROFILING_ENABLE : 0;
+  cl_device_type device_types = CL_DEVICE_TYPE_ALL;
+  ClContext::parseDeviceType(options.device_types, device_types);
+
+  HostBufferPool::getSingletonPtr()->setHugePages(options.huge_pages);
+  HostBufferPool::getSingletonPtr()->setLock(options.lock_memory);
+
+  // the GL contexts live as long as the CL contexts sharing them, i.e. until the process exits.
+  std::vector<GlBackend*> gl_contexts;
+  if (use_gl){
+    gl_contexts = initGlBackends(options.gl_backend, options.gl_displays);
+    if (gl_contexts.empty()){
+      // only the acquire_release test of the overhead suite needs GL, the rest runs on CL alone.
+      // Any other run that would follow needs the context.
+      bool overhead_only = options.overhead_samples > 0 && runModeOptions(options).size() == 1 && options.devices.empty();
+      if (!overhead_only){
+        exit_code = 1;
+        return;
+      }
+      std::cout << "No GL context, the overhead suite runs without acquire_release\n";
+      use_gl = false;
     }
+  }
 
-    printf( "Making context current\n" );
-    glXMakeCurrent( display, win, ctx );
-}
-#endif
+  ClContext* cl = ClContext::getSingletonPtr();
+  cl->init(gl_contexts, queue_properties, device_types);
+
+  if (!options.device_profile.empty()){
+    BenchReport profiles;
+    for (size_t d = 0; d < cl->devices.size(); d++)
+      profiles.add(deviceProfileRecord(cl->devices[d]));
+    if (!profiles.write(options.device_profile))
+      exit_code = 1;
+  }
 
-void myThread(){
-  cl_int error;
-  int dev_idx = 0;
+  if (options.list_devices)
+    return;
 
-  ClContext* cl = ClContext::getSingletonPtr();
-#ifdef _WIN32
-  initGlfw();
-  cl->init();
-#else
-  const char* display_str[2] = { ":0.0", ":0.1" };
-  Display* display[2];
-  Window win[2];
-  GLXContext ctx[2];
-  initGlx(display_str[0], display[0], win[0], ctx[0]);
-  //initGlx(display_str[1], display[1], win[1], ctx[1]);
-  int d = 1;
-  //glXMakeCurrent( display[d], win[d], ctx[d] );
-  cl->init(display, win, ctx);
-#endif
+  cl->setProgramCache(options.program_cache);
+  cl->setFailFast(options.fail_fast);
+  cl->setMemPool(options.mem_pool_arena);
 
-  if (glewInit() != GLEW_OK){
+  if (use_gl && !initGlew(*gl_contexts[0])){
     std::cout << "Cannot init Glew\n";
-    exit(0);
+    exit_code = 1;
+    return;
   }
 
-  std::cout << "\n\n\nChoose The Device: \t";
-
-  do{
-    std::cin >> dev_idx;
-  } while (dev_idx >= cl->devices.size());
-  std::cout << "Device: " << cl->devices[dev_idx].features.device_name << std::endl;
-  bool use_gpu_mem = false;
-
-  std::cout << "Use GL Buffers? \t";
-  char ch; std::cin >> ch;
+  if (!options.devices.empty()){
+    exit_code = runMultiDeviceMain(cl, options);
+    return;
+  }
 
-  if (ch == 'y' || ch == 'Y'){
-    std::cout << "use_gpu_mem = true;\n";
-    use_gpu_mem = true;
+  int dev_idx = cl->findDevice(options.device);
+  if (dev_idx < 0){
+    std::cerr << "No device matches \"" << options.device << "\"\n";
+    exit_code = 1;
+    return;
   }
-  else {
-    std::cout << "use_gpu_mem = false;\n";
-    use_gpu_mem = false;
+  const ClDevice& device = cl->devices[dev_idx];
+  std::cout << "Device: " << device.features.device_name << std::endl;
+  if (use_gl && device.gl)
+    device.gl->makeCurrent();
+
+  // "auto" modes and sizes that do not fit are resolved with the device profile.
+  BenchOptions run_options = options;
+  if (run_options.modes.size() == 1 && run_options.modes[0] == "auto")
+    run_options.modes = autoModes(device.features);
+  run_options.sizes = fitSizes(device.features, options.sizes);
+  if (run_options.sizes.empty()){
+    std::cerr << "None of the sizes fits " << device.features.device_name << std::endl;
+    exit_code = 1;
+    return;
   }
 
-#ifdef _WIN32 
-  cl_kernel mykernel = cl->createKernel("testKernel.cl", "myKernel", cl->devices[dev_idx]);
-#elif _LINUX
-  cl_kernel mykernel = cl->createKernel("/home/smostaja/MultiGPUComputing/testKernel.cl", "myKernel", cl->devices[dev_idx]);
-#endif
-
-  cl_int mem_size = 16 * 1024 * 1024;
-  std::vector<cl_float4> host_a(mem_size), /*host_b(mem_size),*/ host_c(mem_size);
-
-  for (size_t i = 0; i < mem_size; i++){
-    host_a[i].s[0] = rand() % 1000 / 1000.0f;
-    host_a[i].s[1] = rand() % 1000 / 1000.0f;
-    host_a[i].s[2] = rand() % 1000 / 1000.0f;
-    host_a[i].s[3] = 1.0f;
+  cl_kernel mykernel = cl->createKernel(options.kernel_file, "myKernel", device);
+  if (!reportBuilds(cl, options) || !mykernel){
+    if (mykernel)
+      clReleaseKernel(mykernel);
+    exit_code = 1;
+    return;
   }
 
-  //#define USE_GPU_MEM
-  cl_mem device_a, device_c;
-  GLuint gl_buffer_c = 0;
-
-  device_a = clCreateBuffer(cl->devices[dev_idx].ctx, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, mem_size * sizeof(cl_float4), host_a.data(), &error); cl->checkError(error);
+  BenchReport report, timeline;
+  if (options.pipeline_depth > 0)
+    runPipelineComparison(cl, device, mykernel, run_options, report);
+  else if (options.gl_sync)
+    runGlSyncComparison(cl, device, mykernel, run_options, report);
+  else if (options.batch_launches > 0)
+    runBatchedComparison(cl, device, mykernel, run_options, report);
+  else if (options.overhead_samples > 0)
+    runOverheadSuite(cl, device, mykernel, run_options, report);
+  else if (options.sweep)
+    runSweep(cl, device, mykernel, run_options, report, options.timeline.empty() ? nullptr : &timeline);
+  else if (options.tune)
+    runTuned(cl, device, run_options, report, options.timeline.empty() ? nullptr : &timeline);
+  else if (!options.variants.empty())
+    runVariants(cl, device, run_options, report, options.timeline.empty() ? nullptr : &timeline);
+  else
+    runSizeList(cl, device, mykernel, run_options, report, options.timeline.empty() ? nullptr : &timeline);
+
+  clReleaseKernel(mykernel);
+  cl->releasePrograms();
+
+  HostBufferPool::getSingletonPtr()->printReport();
+  report.add(HostBufferPool::getSingletonPtr()->toRecord());
+  reportMemPool(cl, device, report);
+  if (!report.write(options.output))
+    exit_code = 1;
+  if (!options.timeline.empty() && !timeline.write(options.timeline))
+    exit_code = 1;
+}
 
-  if (!use_gpu_mem){
-    device_c = clCreateBuffer(cl->devices[dev_idx].ctx, CL_MEM_WRITE_ONLY, mem_size * sizeof(cl_float4), nullptr, &error); cl->checkError(error);
+// With a report on stdout ("-"), stdout is moved to stderr at the descriptor level, which also takes the
+// output of printf and of the drivers, and only the reports are written to the original stdout.
+static void reserveStdoutForReports(const BenchOptions& options){
+  if (options.output != "-" && options.timeline != "-" && options.build_report != "-" && options.device_profile != "-")
+    return;
+  fflush(stdout);
+  int report_fd = dup(1);
+  FILE* report_stdout = report_fd >= 0 ? fdopen(report_fd, "w") : 0;
+  if (!report_stdout || dup2(2, 1) < 0){
+    std::cerr << "Cannot separate the report from the progress output on stdout\n";
+    return;
   }
-  else {
-
-    glGenBuffers(1, &gl_buffer_c);
-    glBindBuffer(GL_ARRAY_BUFFER, gl_buffer_c);
-    glBufferData(GL_ARRAY_BUFFER, mem_size*sizeof(cl_float4), nullptr, GL_STATIC_DRAW);
+  BenchReport::setStdout(report_stdout);
+}
 
-    device_c = clCreateFromGLBuffer(cl->devices[dev_idx].ctx, CL_MEM_WRITE_ONLY, gl_buffer_c, &error);              cl->checkError(error);
+int main(int argc, char** argv) {
 
+  BenchOptions options;
+  std::string error;
+  if (!parseBenchOptions(argc, argv, options, error)){
+    std::cerr << error << std::endl;
+    printBenchUsage(argv[0]);
+    return 1;
   }
-
-  while (true){
-
-    float avg_time = 0.0f;
-    const int n_tests = 100;
-    std::vector<cl_float4> temp_mem(mem_size);
-    for (size_t i = 0; i < n_tests; i++){
-
-      //===============================
-      // Draw
-      //===============================
-      //glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-      //glfwSwapBuffers(win);
-
-      //===============================
-      // update
-      //===============================
-      if (use_gpu_mem){
-        glFinish();
-        error = clEnqueueAcquireGLObjects(cl->devices[dev_idx].cmd_queue, 1, &device_c, 0, nullptr, nullptr); cl->checkError(error);
-      }
-
-      clSetKernelArg(mykernel, 0, sizeof(cl_mem), &device_a);
-      clSetKernelArg(mykernel, 1, sizeof(cl_mem), &device_c);
-      clSetKernelArg(mykernel, 2, sizeof(cl_int), &mem_size);
-
-      size_t nKernels = mem_size;
-      size_t local_ws = 32;
-      size_t global_ws = (nKernels + local_ws - 1) / local_ws * local_ws;
-
-      clock_t beg_time = clock();
-      //std::cout << "Beg Time: " << beg_time << std::endl;
-      error = clEnqueueNDRangeKernel(cl->devices[dev_idx].cmd_queue, mykernel, 1, nullptr, &global_ws, &local_ws, 0, nullptr, nullptr); cl->checkError(error);
-
-
-      if (use_gpu_mem){
-        error = clEnqueueReleaseGLObjects(cl->devices[dev_idx].cmd_queue, 1, &device_c, 0, nullptr, nullptr); cl->checkError(error);
-      }
-      else {
-
-        clEnqueueReadBuffer(cl->devices[dev_idx].cmd_queue, device_c, CL_TRUE, 0, mem_size * sizeof(cl_float4), temp_mem.data(), 0, nullptr, nullptr);
-        glBindBuffer(GL_ARRAY_BUFFER, gl_buffer_c);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, mem_size * sizeof(cl_float4), temp_mem.data());
-      }
-
-      clFinish(cl->devices[dev_idx].cmd_queue);
-      clock_t end_time = clock();
-      avg_time += static_cast<float>((end_time - beg_time)) / CLOCKS_PER_SEC;
-    }
-    avg_time /= n_tests;
-
-    std::cout << "Execution Time (Avg.)  = " << 1.0f / avg_time << std::endl;
+  if (options.help){
+    printBenchUsage(argv[0]);
+    return 0;
   }
-}
 
-int main() {
+  reserveStdoutForReports(options);
 
-  boost::thread t(myThread);
+  int exit_code = 0;
+  boost::thread t(boost::bind(myThread, boost::cref(options), boost::ref(exit_code)));
 
   t.join();
 
-  return 0;
+  return exit_code;
 }
@@ -1,12 +1,121 @@
+// Specialized through ClKernelVariant, the defaults are the plain float4 copy.
+#ifndef ELEMENT_TYPE
+#define ELEMENT_TYPE float4
+#endif
+#ifndef SCALAR_TYPE
+#define SCALAR_TYPE float
+#endif
+#ifndef VECTOR_WIDTH
+#define VECTOR_WIDTH 4
+#endif
+#ifndef ELEMENTS_PER_ITEM
+#define ELEMENTS_PER_ITEM 1
+#endif
+#ifndef COMPUTE_ITERATIONS
+#define COMPUTE_ITERATIONS 64
+#endif
+
+// In all kernels count is the number of ELEMENT_TYPE elements.
+
+// Every work-item copies ELEMENTS_PER_ITEM elements, one global size apart,
+// so neighbouring work-items always access neighbouring elements.
 __kernel void myKernel(
-  __global float4* a,
-  __global float4* c,
+  __global ELEMENT_TYPE* a,
+  __global ELEMENT_TYPE* c,
+  int count
+  ){
+
+  int thread_idx = get_global_id(0);
+  int stride = get_global_size(0);
+
+  for (int i = 0; i < ELEMENTS_PER_ITEM; i++){
+    int idx = thread_idx + i * stride;
+    if (idx >= count) return;
+    c[idx]  = a[idx];
+  }
+}
+
+// Grid-stride loop: works for any global size, the loop count is not known at compile time.
+__kernel void copyGridStride(
+  __global const ELEMENT_TYPE* restrict a,
+  __global ELEMENT_TYPE* restrict c,
+  int count
+  ){
+
+  int stride = get_global_size(0);
+  for (int idx = get_global_id(0); idx < count; idx += stride)
+    c[idx] = a[idx];
+}
+
+// Scalar pointers with explicit vloadn/vstoren, the vector type hint tells the compiler
+// which width the loads are meant for.
+#define VLOAD_(n)  vload##n
+#define VLOAD(n)   VLOAD_(n)
+#define VSTORE_(n) vstore##n
+#define VSTORE(n)  VSTORE_(n)
+
+__kernel __attribute__((vec_type_hint(ELEMENT_TYPE)))
+void copyVload(
+  __global const SCALAR_TYPE* restrict a,
+  __global SCALAR_TYPE* restrict c,
+  int count
+  ){
+
+  int thread_idx = get_global_id(0);
+  int stride = get_global_size(0);
+
+  for (int i = 0; i < ELEMENTS_PER_ITEM; i++){
+    int idx = thread_idx + i * stride;
+    if (idx >= count) return;
+#if VECTOR_WIDTH == 1
+    c[idx] = a[idx];
+#else
+    VSTORE(VECTOR_WIDTH)(VLOAD(VECTOR_WIDTH)(idx, a), idx, c);
+#endif
+  }
+}
+
+// Global -> local -> global with async_work_group_copy. tile holds
+// get_local_size(0) * ELEMENTS_PER_ITEM elements, it is set by the host.
+__kernel void copyLocal(
+  __global const ELEMENT_TYPE* restrict a,
+  __global ELEMENT_TYPE* restrict c,
+  int count,
+  __local ELEMENT_TYPE* tile
+  ){
+
+  int tile_size = get_local_size(0) * ELEMENTS_PER_ITEM;
+  int base = get_group_id(0) * tile_size;
+  if (base >= count) return;
+  int n = min(tile_size, count - base);
+
+  event_t in = async_work_group_copy(tile, a + base, n, 0);
+  wait_group_events(1, &in);
+  event_t out = async_work_group_copy(c + base, tile, n, 0);
+  wait_group_events(1, &out);
+}
+
+// Copy with COMPUTE_ITERATIONS dependent multiply-adds per element (2 flops per component each),
+// raising the arithmetic intensity until the device is compute bound.
+__kernel void copyCompute(
+  __global const ELEMENT_TYPE* restrict a,
+  __global ELEMENT_TYPE* restrict c,
   int count
-  ){ 
+  ){
 
   int thread_idx = get_global_id(0);
-  if (thread_idx >= count) return;
+  int stride = get_global_size(0);
 
-  c[thread_idx]  = a[thread_idx];
+  for (int i = 0; i < ELEMENTS_PER_ITEM; i++){
+    int idx = thread_idx + i * stride;
+    if (idx >= count) return;
+    ELEMENT_TYPE x = a[idx];
+    for (int k = 0; k < COMPUTE_ITERATIONS; k++)
+      x = mad(x, (ELEMENT_TYPE)(0.9999f), (ELEMENT_TYPE)(0.0001f));
+    c[idx] = x;
+  }
 }
 
+// Does nothing: the launch overhead of the driver, see OverheadBenchmark.
+__kernel void emptyKernel(){
+}